@@ -2853,6 +2853,78 @@ static void test_delete_key_value(void)
     RegCloseKey(subkey);
 }
 
+static void test_many_subkeys(void)
+{
+    HKEY hkey, subkey;
+    char name[16], buffer[16];
+    DWORD count;
+    LONG ret;
+    int i;
+
+    ret = RegCreateKeyA( hkey_main, "ManySubkeys", &hkey );
+    ok( !ret, "RegCreateKeyA failed: %d\n", ret );
+
+    /* create them in reverse order so that the entries need sorting */
+    for (i = 999; i >= 0; i--)
+    {
+        sprintf( name, "key%04u", i );
+        ret = RegCreateKeyA( hkey, name, &subkey );
+        ok( !ret, "RegCreateKeyA %s failed: %d\n", name, ret );
+        RegCloseKey( subkey );
+        ret = RegSetValueExA( hkey, name, 0, REG_DWORD, (const BYTE *)&i, sizeof(i) );
+        ok( !ret, "RegSetValueExA %s failed: %d\n", name, ret );
+    }
+
+    ret = RegQueryInfoKeyA( hkey, NULL, NULL, NULL, &count, NULL, NULL, NULL, NULL, NULL, NULL, NULL );
+    ok( !ret, "RegQueryInfoKeyA failed: %d\n", ret );
+    ok( count == 1000, "expected 1000 subkeys, got %u\n", count );
+
+    for (i = 0; i < 1000; i++)
+    {
+        sprintf( name, "key%04u", i );
+        ret = RegEnumKeyA( hkey, i, buffer, sizeof(buffer) );
+        ok( !ret, "RegEnumKeyA %u failed: %d\n", i, ret );
+        ok( !strcmp( buffer, name ), "%u: expected %s, got %s\n", i, name, buffer );
+        ret = RegOpenKeyA( hkey, name, &subkey );
+        ok( !ret, "RegOpenKeyA %s failed: %d\n", name, ret );
+        RegCloseKey( subkey );
+        ret = RegQueryValueExA( hkey, name, NULL, NULL, NULL, NULL );
+        ok( !ret, "RegQueryValueExA %s failed: %d\n", name, ret );
+    }
+
+    for (i = 0; i < 1000; i += 2)
+    {
+        sprintf( name, "KEY%04u", i );
+        ret = RegDeleteKeyA( hkey, name );
+        ok( !ret, "RegDeleteKeyA %s failed: %d\n", name, ret );
+        ret = RegDeleteValueA( hkey, name );
+        ok( !ret, "RegDeleteValueA %s failed: %d\n", name, ret );
+    }
+
+    for (i = 0; i < 1000; i++)
+    {
+        sprintf( name, "key%04u", i );
+        ret = RegOpenKeyA( hkey, name, &subkey );
+        if (i & 1)
+        {
+            ok( !ret, "RegOpenKeyA %s failed: %d\n", name, ret );
+            RegCloseKey( subkey );
+        }
+        else ok( ret == ERROR_FILE_NOT_FOUND, "RegOpenKeyA %s returned %d\n", name, ret );
+    }
+
+    for (i = 0; i < 500; i++)
+    {
+        sprintf( name, "key%04u", 2 * i + 1 );
+        ret = RegEnumKeyA( hkey, i, buffer, sizeof(buffer) );
+        ok( !ret, "RegEnumKeyA %u failed: %d\n", i, ret );
+        ok( !strcmp( buffer, name ), "%u: expected %s, got %s\n", i, name, buffer );
+    }
+
+    delete_key( hkey );
+    RegCloseKey( hkey );
+}
+
 START_TEST(registry)
 {
     /* Load pointers for functions that are not available in all Windows versions */
@@ -2894,6 +2966,7 @@ START_TEST(registry)
     test_deleted_key();
     test_delete_value();
     test_delete_key_value();
+    test_many_subkeys();
 
     /* cleanup */
     delete_key( hkey_main );
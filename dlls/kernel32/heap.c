@@ -294,12 +294,37 @@ BOOL WINAPI HeapQueryInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class
     return !ret;
 }
 
-BOOL WINAPI HeapSetInformation( HANDLE heap, HEAP_INFORMATION_CLASS infoclass, PVOID info, SIZE_T size)
+BOOL WINAPI HeapSummary( HANDLE heap, DWORD flags, LPHEAP_SUMMARY summary )
 {
-    FIXME("%p %d %p %ld\n", heap, infoclass, info, size );
+    RTL_HEAP_USAGE usage;
+    NTSTATUS ret;
+
+    if (!summary || summary->cb != sizeof(*summary))
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return FALSE;
+    }
+    memset( &usage, 0, sizeof(usage) );
+    usage.Length = sizeof(usage);
+    if ((ret = RtlUsageHeap( heap, flags, &usage )))
+    {
+        SetLastError( RtlNtStatusToDosError(ret) );
+        return FALSE;
+    }
+    summary->cbAllocated  = usage.BytesAllocated;
+    summary->cbCommitted  = usage.BytesCommitted;
+    summary->cbReserved   = usage.BytesReserved;
+    summary->cbMaxReserve = usage.BytesReservedMaximum;
     return TRUE;
 }
 
+BOOL WINAPI HeapSetInformation( HANDLE heap, HEAP_INFORMATION_CLASS infoclass, PVOID info, SIZE_T size)
+{
+    NTSTATUS ret = RtlSetHeapInformation( heap, infoclass, info, size );
+    if (ret) SetLastError( RtlNtStatusToDosError(ret) );
+    return !ret;
+}
+
 /*
  * Win32 Global heap functions (GlobalXXX).
  * These functions included in Win32 for compatibility with 16 bit Windows
@@ -2073,6 +2073,44 @@ cleanup:
     DeleteFileA( filename );
 }
 
+static void test_LockFile_many(void)
+{
+    HANDLE handle, handle2;
+    DWORD i;
+
+    handle = CreateFileA( filename, GENERIC_READ | GENERIC_WRITE,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                          CREATE_ALWAYS, 0, 0 );
+    ok( handle != INVALID_HANDLE_VALUE, "couldn't create file \"%s\" (err=%d)\n", filename, GetLastError() );
+    if (handle == INVALID_HANDLE_VALUE) return;
+    handle2 = CreateFileA( filename, GENERIC_READ | GENERIC_WRITE,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                           OPEN_EXISTING, 0, 0 );
+    ok( handle2 != INVALID_HANDLE_VALUE, "couldn't open file \"%s\" (err=%d)\n", filename, GetLastError() );
+
+    /* lock every other 16-byte block, in reverse order */
+    for (i = 5000; i > 0; i--)
+        ok( LockFile( handle, (i - 1) * 32, 0, 16, 0 ), "LockFile %u failed\n", i - 1 );
+
+    for (i = 0; i < 5000; i++)
+    {
+        ok( !LockFile( handle2, i * 32 + 8, 0, 16, 0 ), "LockFile %u overlapping succeeded\n", i );
+        ok( LockFile( handle2, i * 32 + 16, 0, 16, 0 ), "LockFile %u in hole failed\n", i );
+    }
+    for (i = 0; i < 5000; i += 2)
+    {
+        ok( UnlockFile( handle, i * 32, 0, 16, 0 ), "UnlockFile %u failed\n", i );
+        ok( !UnlockFile( handle, i * 32, 0, 16, 0 ), "UnlockFile %u succeeded twice\n", i );
+        ok( LockFile( handle2, i * 32, 0, 8, 0 ), "LockFile %u after unlock failed\n", i );
+    }
+    for (i = 1; i < 5000; i += 2)
+        ok( !LockFile( handle2, i * 32, 0, 8, 0 ), "LockFile %u still locked succeeded\n", i );
+
+    CloseHandle( handle2 );
+    CloseHandle( handle );
+    DeleteFileA( filename );
+}
+
 static BOOL create_fake_dll( LPCSTR filename )
 {
     IMAGE_DOS_HEADER *dos;
@@ -4118,6 +4156,7 @@ START_TEST(file)
     /* FindExLimitToDirectories is ignored if the file system doesn't support directory filtering */
     test_FindFirstFileExA(FindExSearchLimitToDirectories);
     test_LockFile();
+    test_LockFile_many();
     test_file_sharing();
     test_offset_in_overlapped_structure();
     test_MapFile();
@@ -39,6 +39,7 @@
 #define HEAP_VALIDATE_PARAMS  0x40000000
 
 static BOOL (WINAPI *pHeapQueryInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T, PSIZE_T);
+static BOOL (WINAPI *pHeapSetInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T);
 static ULONG (WINAPI *pRtlGetNtGlobalFlags)(void);
 
 struct heap_layout
@@ -853,6 +854,238 @@ static void test_HeapQueryInformation(void)
     ok(info == 0 || info == 1 || info == 2, "expected 0, 1 or 2, got %u\n", info);
 }
 
+static DWORD WINAPI lfh_thread( void *arg )
+{
+    HANDLE heap = arg;
+    BYTE *ptrs[64];
+    unsigned int i, j;
+
+    for (i = 0; i < 200; i++)
+    {
+        for (j = 0; j < 64; j++)
+        {
+            ptrs[j] = HeapAlloc( heap, 0, 8 + (j % 16) * 16 );
+            if (!ptrs[j]) return 1;
+            memset( ptrs[j], j, 8 );
+        }
+        for (j = 0; j < 64; j++)
+        {
+            if (ptrs[j][0] != j || ptrs[j][7] != j) return 1;
+            if (!HeapFree( heap, 0, ptrs[j] )) return 1;
+        }
+    }
+    return 0;
+}
+
+#define HEAP_BENCH_THREADS     4
+#define HEAP_BENCH_ITERATIONS  20000
+
+static DWORD WINAPI heap_bench_thread( void *arg )
+{
+    HANDLE heap = arg;
+    void *ptrs[32];
+    unsigned int i, j;
+
+    for (i = 0; i < HEAP_BENCH_ITERATIONS; i++)
+    {
+        for (j = 0; j < 32; j++) ptrs[j] = HeapAlloc( heap, 0, 16 + (j % 8) * 24 );
+        for (j = 0; j < 32; j++) HeapFree( heap, 0, ptrs[j] );
+    }
+    return 0;
+}
+
+static DWORD bench_heap( HANDLE heap )
+{
+    HANDLE threads[HEAP_BENCH_THREADS];
+    DWORD start;
+    unsigned int i;
+
+    start = GetTickCount();
+    for (i = 0; i < HEAP_BENCH_THREADS; i++)
+        threads[i] = CreateThread( NULL, 0, heap_bench_thread, heap, 0, NULL );
+    for (i = 0; i < HEAP_BENCH_THREADS; i++)
+    {
+        WaitForSingleObject( threads[i], INFINITE );
+        CloseHandle( threads[i] );
+    }
+    return GetTickCount() - start;
+}
+
+/* multi-threaded alloc/free throughput, with and without the low fragmentation heap */
+static void test_heap_performance(void)
+{
+    ULONG info = 2;
+    HANDLE heap;
+    DWORD time;
+
+    if (!winetest_interactive)
+    {
+        skip( "heap benchmark, set WINETEST_INTERACTIVE to run it\n" );
+        return;
+    }
+
+    heap = HeapCreate( 0, 0, 0 );
+    time = bench_heap( heap );
+    trace( "standard heap: %u threads x %u alloc/free pairs in %u ms\n",
+           HEAP_BENCH_THREADS, HEAP_BENCH_ITERATIONS * 32, time );
+    HeapDestroy( heap );
+
+    heap = HeapCreate( 0, 0, 0 );
+    if (!pHeapSetInformation || !pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) ))
+    {
+        skip( "low fragmentation heap not available\n" );
+        HeapDestroy( heap );
+        return;
+    }
+    time = bench_heap( heap );
+    trace( "low fragmentation heap: %u threads x %u alloc/free pairs in %u ms\n",
+           HEAP_BENCH_THREADS, HEAP_BENCH_ITERATIONS * 32, time );
+    HeapDestroy( heap );
+}
+
+static void test_HeapSetInformation(void)
+{
+    HANDLE heap, heap2, threads[4];
+    ULONG info;
+    DWORD code;
+    BYTE *p, *p2, **blocks;
+    unsigned int i;
+    BOOL ret;
+
+    pHeapSetInformation = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "HeapSetInformation");
+    if (!pHeapSetInformation || !pHeapQueryInformation)
+    {
+        win_skip("HeapSetInformation is not available\n");
+        return;
+    }
+
+    heap = HeapCreate( HEAP_NO_SERIALIZE, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+    info = 2;
+    SetLastError(0xdeadbeef);
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( !ret, "HeapSetInformation should fail on a HEAP_NO_SERIALIZE heap\n" );
+    HeapDestroy( heap );
+
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+    info = 2;
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    if (!ret)
+    {
+        /* the low fragmentation heap can't be enabled when running under a debugger */
+        skip( "low fragmentation heap not available\n" );
+        HeapDestroy( heap );
+        return;
+    }
+    info = 0xdeadbeef;
+    ret = pHeapQueryInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( ret, "HeapQueryInformation error %u\n", GetLastError() );
+    ok( info == 2, "expected 2, got %u\n", info );
+
+    p = HeapAlloc( heap, 0, 40 );
+    ok( p != NULL, "HeapAlloc failed\n" );
+    memset( p, 0xcc, 40 );
+    ret = HeapFree( heap, 0, p );
+    ok( ret, "HeapFree failed\n" );
+
+    p2 = HeapAlloc( heap, HEAP_ZERO_MEMORY, 40 );
+    ok( p2 != NULL, "HeapAlloc failed\n" );
+    for (i = 0; i < 40; i++) if (p2[i]) break;
+    ok( i == 40, "memory not zeroed at offset %u\n", i );
+    ok( HeapSize( heap, 0, p2 ) == 40, "wrong size %lu\n", HeapSize( heap, 0, p2 ) );
+    p = HeapReAlloc( heap, 0, p2, 37 );
+    ok( p != NULL, "HeapReAlloc failed\n" );
+    ok( HeapSize( heap, 0, p ) == 37, "wrong size %lu\n", HeapSize( heap, 0, p ) );
+    ret = HeapFree( heap, 0, p );
+    ok( ret, "HeapFree failed\n" );
+
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+        threads[i] = CreateThread( NULL, 0, lfh_thread, heap, 0, NULL );
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+    {
+        ok( !WaitForSingleObject( threads[i], 20000 ), "thread %u didn't finish\n", i );
+        GetExitCodeThread( threads[i], &code );
+        ok( !code, "thread %u failed\n", i );
+        CloseHandle( threads[i] );
+    }
+
+    ret = HeapValidate( heap, 0, NULL );
+    ok( ret, "HeapValidate failed\n" );
+
+    /* blocks in the sub-heaps added when the heap grows */
+    blocks = HeapAlloc( GetProcessHeap(), 0, 65536 * sizeof(*blocks) );
+    for (i = 0; i < 65536; i++)
+    {
+        blocks[i] = HeapAlloc( heap, 0, 64 );
+        ok( blocks[i] != NULL, "HeapAlloc failed\n" );
+        if (!blocks[i]) break;
+    }
+    while (i--)
+    {
+        ret = HeapFree( heap, 0, blocks[i] );
+        ok( ret, "HeapFree failed\n" );
+    }
+    for (i = 0; i < 65536; i++) if (!(blocks[i] = HeapAlloc( heap, 0, 64 ))) break;
+    ok( i == 65536, "HeapAlloc failed\n" );
+    while (i--) HeapFree( heap, 0, blocks[i] );
+    HeapFree( GetProcessHeap(), 0, blocks );
+    ret = HeapValidate( heap, 0, NULL );
+    ok( ret, "HeapValidate failed\n" );
+
+    /* a block from another heap must not end up on the lookaside lists */
+    heap2 = HeapCreate( 0, 0, 0 );
+    ok( heap2 != NULL, "HeapCreate failed\n" );
+    p = HeapAlloc( heap2, 0, 40 );
+    ok( p != NULL, "HeapAlloc failed\n" );
+    SetLastError(0xdeadbeef);
+    ret = HeapFree( heap, 0, p );
+    ok( !ret || broken(ret), "HeapFree succeeded for a block of another heap\n" );
+    if (!ret)
+    {
+        p2 = HeapAlloc( heap, 0, 40 );
+        ok( p2 != p, "got the block of another heap\n" );
+        HeapFree( heap, 0, p2 );
+        ret = HeapFree( heap2, 0, p );
+        ok( ret, "HeapFree failed\n" );
+    }
+    HeapDestroy( heap2 );
+
+    ret = HeapDestroy( heap );
+    ok( ret, "HeapDestroy failed\n" );
+}
+
+static void test_HeapSummary(void)
+{
+    HEAP_SUMMARY summary;
+    HANDLE heap;
+    void *p;
+    BOOL ret;
+
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+    p = HeapAlloc( heap, 0, 1000 );
+    ok( p != NULL, "HeapAlloc failed\n" );
+
+    memset( &summary, 0, sizeof(summary) );
+    SetLastError( 0xdeadbeef );
+    ret = HeapSummary( heap, 0, &summary );
+    ok( !ret, "HeapSummary should fail with an invalid size\n" );
+
+    memset( &summary, 0, sizeof(summary) );
+    summary.cb = sizeof(summary);
+    ret = HeapSummary( heap, 0, &summary );
+    ok( ret, "HeapSummary failed %u\n", GetLastError() );
+    ok( summary.cbAllocated >= 1000, "wrong allocated size %lu\n", summary.cbAllocated );
+    ok( summary.cbCommitted >= summary.cbAllocated, "committed %lu < allocated %lu\n",
+        summary.cbCommitted, summary.cbAllocated );
+    ok( summary.cbReserved >= summary.cbCommitted, "reserved %lu < committed %lu\n",
+        summary.cbReserved, summary.cbCommitted );
+
+    HeapFree( heap, 0, p );
+    HeapDestroy( heap );
+}
+
 static void test_heap_checks( DWORD flags )
 {
     BYTE old, *p, *p2;
@@ -1173,6 +1406,9 @@ START_TEST(heap)
     test_sized_HeapReAlloc((1 << 20), (2 << 20));
     test_sized_HeapReAlloc((1 << 20), 1);
     test_HeapQueryInformation();
+    test_HeapSetInformation();
+    test_HeapSummary();
+    test_heap_performance();
 
     if (pRtlGetNtGlobalFlags)
     {
@@ -1339,6 +1339,157 @@ static void test_import_resolution(void)
     }
 }
 
+struct reloc_data
+{
+    IMAGE_BASE_RELOCATION reloc;
+    WORD fixups[2];
+    ULONG_PTR ptrs[2];
+    char str[16];
+};
+
+#define RELOC_IMAGE_BASE 0x12350000
+#define RELOC_DATA_RVA(ptr) (page_size + ((char *)(ptr) - (char *)&data))
+
+static void check_relocated_image( HMODULE mod, const char *dll_name )
+{
+    struct reloc_data data, *ptr;
+
+    ok( mod != (HMODULE)RELOC_IMAGE_BASE, "%s loaded at its preferred base\n", dll_name );
+    ptr = (struct reloc_data *)((char *)mod + page_size);
+    ok( ptr->ptrs[0] == (ULONG_PTR)mod + RELOC_DATA_RVA( data.str ),
+        "wrong relocated pointer %p for base %p\n", (void *)ptr->ptrs[0], mod );
+    ok( ptr->ptrs[1] == (ULONG_PTR)mod + RELOC_DATA_RVA( &data.ptrs[1] ),
+        "wrong relocated pointer %p for base %p\n", (void *)ptr->ptrs[1], mod );
+    ok( !strcmp( ptr->str, "hello world" ), "wrong data %s\n", ptr->str );
+}
+
+static void child_relocated_image( const char *dll_name, const char *parent_base )
+{
+    HMODULE mod;
+    void *reserve;
+
+    reserve = VirtualAlloc( (void *)RELOC_IMAGE_BASE, 2 * page_size, MEM_RESERVE, PAGE_NOACCESS );
+    ok( reserve == (void *)RELOC_IMAGE_BASE, "failed to reserve the image base err %u\n", GetLastError() );
+    mod = LoadLibraryA( dll_name );
+    ok( mod != NULL, "failed to load err %u\n", GetLastError() );
+    if (!mod) return;
+    if (mod == (HMODULE)(ULONG_PTR)strtoul( parent_base, NULL, 16 ))
+        trace( "%s loaded at the same address as in the parent\n", dll_name );
+    check_relocated_image( mod, dll_name );
+    FreeLibrary( mod );
+    VirtualFree( reserve, 0, MEM_RELEASE );
+}
+
+static void test_relocated_image(void)
+{
+    char temp_path[MAX_PATH];
+    char dll_name[MAX_PATH];
+    char cmdline[MAX_PATH * 2];
+    char **argv;
+    DWORD dummy;
+    HANDLE hfile;
+    HMODULE mod;
+    void *reserve;
+    struct reloc_data data;
+    IMAGE_NT_HEADERS nt;
+    IMAGE_SECTION_HEADER section;
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    BOOL ret;
+
+    nt = nt_header;
+    nt.FileHeader.NumberOfSections = 1;
+    nt.FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+    nt.FileHeader.Characteristics = IMAGE_FILE_EXECUTABLE_IMAGE | IMAGE_FILE_DLL;
+    nt.OptionalHeader.ImageBase = RELOC_IMAGE_BASE;
+    nt.OptionalHeader.SectionAlignment = page_size;
+    nt.OptionalHeader.FileAlignment = 0x200;
+    nt.OptionalHeader.SizeOfImage = 2 * page_size;
+    nt.OptionalHeader.SizeOfHeaders = nt.OptionalHeader.FileAlignment;
+    nt.OptionalHeader.NumberOfRvaAndSizes = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+    memset( nt.OptionalHeader.DataDirectory, 0, sizeof(nt.OptionalHeader.DataDirectory) );
+    nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].Size = sizeof(data.reloc) + sizeof(data.fixups);
+    nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].VirtualAddress = RELOC_DATA_RVA( &data.reloc );
+
+    memset( &data, 0, sizeof(data) );
+    data.reloc.VirtualAddress = page_size;
+    data.reloc.SizeOfBlock = sizeof(data.reloc) + sizeof(data.fixups);
+#ifdef _WIN64
+    data.fixups[0] = (IMAGE_REL_BASED_DIR64 << 12) | (RELOC_DATA_RVA( &data.ptrs[0] ) - page_size);
+    data.fixups[1] = (IMAGE_REL_BASED_DIR64 << 12) | (RELOC_DATA_RVA( &data.ptrs[1] ) - page_size);
+#else
+    data.fixups[0] = (IMAGE_REL_BASED_HIGHLOW << 12) | (RELOC_DATA_RVA( &data.ptrs[0] ) - page_size);
+    data.fixups[1] = (IMAGE_REL_BASED_HIGHLOW << 12) | (RELOC_DATA_RVA( &data.ptrs[1] ) - page_size);
+#endif
+    data.ptrs[0] = RELOC_IMAGE_BASE + RELOC_DATA_RVA( data.str );
+    data.ptrs[1] = RELOC_IMAGE_BASE + RELOC_DATA_RVA( &data.ptrs[1] );
+    strcpy( data.str, "hello world" );
+
+    GetTempPathA(MAX_PATH, temp_path);
+    GetTempFileNameA(temp_path, "ldr", 0, dll_name);
+
+    hfile = CreateFileA(dll_name, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, 0, 0);
+    ok( hfile != INVALID_HANDLE_VALUE, "creation failed\n" );
+
+    memset( &section, 0, sizeof(section) );
+    memcpy( section.Name, ".data", sizeof(".data") );
+    section.PointerToRawData = nt.OptionalHeader.FileAlignment;
+    section.VirtualAddress = nt.OptionalHeader.SectionAlignment;
+    section.Misc.VirtualSize = sizeof(data);
+    section.SizeOfRawData = sizeof(data);
+    section.Characteristics = IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ | IMAGE_SCN_MEM_WRITE;
+
+    WriteFile(hfile, &dos_header, sizeof(dos_header), &dummy, NULL);
+    WriteFile(hfile, &nt, sizeof(nt), &dummy, NULL);
+    WriteFile(hfile, &section, sizeof(section), &dummy, NULL);
+
+    SetFilePointer( hfile, section.PointerToRawData, NULL, SEEK_SET );
+    WriteFile(hfile, &data, sizeof(data), &dummy, NULL);
+
+    CloseHandle( hfile );
+
+    /* block the preferred base so that the image gets relocated */
+    reserve = VirtualAlloc( (void *)RELOC_IMAGE_BASE, 2 * page_size, MEM_RESERVE, PAGE_NOACCESS );
+    if (reserve != (void *)RELOC_IMAGE_BASE)
+    {
+        skip( "failed to reserve the image base\n" );
+        DeleteFileA( dll_name );
+        return;
+    }
+    mod = LoadLibraryA( dll_name );
+    ok( mod != NULL, "failed to load err %u\n", GetLastError() );
+    if (mod)
+    {
+        check_relocated_image( mod, dll_name );
+
+        /* load it in another process too, the relocated contents may be shared */
+        winetest_get_mainargs( &argv );
+        sprintf( cmdline, "\"%s\" loader reloc %s %p", argv[0], dll_name, mod );
+        ret = CreateProcessA( argv[0], cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi );
+        ok( ret, "CreateProcess(%s) error %d\n", cmdline, GetLastError() );
+        if (ret)
+        {
+            winetest_wait_child_process( pi.hProcess );
+            CloseHandle( pi.hThread );
+            CloseHandle( pi.hProcess );
+        }
+
+        /* the contents are still correct after loading the image again */
+        FreeLibrary( mod );
+        mod = LoadLibraryA( dll_name );
+        ok( mod != NULL, "failed to load err %u\n", GetLastError() );
+        if (mod)
+        {
+            check_relocated_image( mod, dll_name );
+            FreeLibrary( mod );
+        }
+    }
+    VirtualFree( reserve, 0, MEM_RELEASE );
+    DeleteFileA( dll_name );
+}
+
+#undef RELOC_DATA_RVA
+
 #define MAX_COUNT 10
 static HANDLE attached_thread[MAX_COUNT];
 static DWORD attached_thread_count;
@@ -2789,6 +2940,11 @@ START_TEST(loader)
         *child_failures = -1;
 
     argc = winetest_get_mainargs(&argv);
+    if (argc > 4 && !strcmp( argv[2], "reloc" ))
+    {
+        child_relocated_image( argv[3], argv[4] );
+        return;
+    }
     if (argc > 4)
     {
         test_dll_phase = atoi(argv[4]);
@@ -2801,5 +2957,6 @@ START_TEST(loader)
     test_ImportDescriptors();
     test_section_access();
     test_import_resolution();
+    test_relocated_image();
     test_ExitProcess();
 }
@@ -57,6 +57,7 @@ static VOID   (WINAPI *pReleaseSRWLockShared)(PSRWLOCK);
 static BOOLEAN (WINAPI *pTryAcquireSRWLockExclusive)(PSRWLOCK);
 static BOOLEAN (WINAPI *pTryAcquireSRWLockShared)(PSRWLOCK);
 static NTSTATUS (WINAPI *pNtWaitForMultipleObjects)(ULONG,const HANDLE*,BOOLEAN,BOOLEAN,const LARGE_INTEGER*);
+static BOOL   (WINAPI *pGetQueuedCompletionStatusEx)(HANDLE,OVERLAPPED_ENTRY*,ULONG,ULONG*,DWORD,BOOL);
 
 static void test_signalandwait(void)
 {
@@ -491,6 +492,144 @@ static void test_semaphore(void)
     CloseHandle( handle );
 }
 
+static DWORD WINAPI wait_event_thread( void *arg )
+{
+    return WaitForSingleObject( arg, 5000 );
+}
+
+static void test_unnamed_sync_objects(void)
+{
+    HANDLE event, event2, sem, thread, handles[2];
+    LONG prev;
+    DWORD ret;
+
+    event = CreateEventA( NULL, FALSE, FALSE, NULL );
+    ok( event != NULL, "CreateEvent failed with error %u\n", GetLastError() );
+    ret = WaitForSingleObject( event, 0 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", ret );
+    SetEvent( event );
+    ret = WaitForSingleObject( event, 0 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret );
+    ret = WaitForSingleObject( event, 0 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", ret );
+
+    /* the state is kept when the event is used through another handle */
+    SetEvent( event );
+    ret = DuplicateHandle( GetCurrentProcess(), event, GetCurrentProcess(), &event2, 0, FALSE, DUPLICATE_SAME_ACCESS );
+    ok( ret, "DuplicateHandle failed with error %u\n", GetLastError() );
+    ret = WaitForSingleObject( event2, 0 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret );
+    ret = WaitForSingleObject( event, 0 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", ret );
+    SetEvent( event );
+    ret = WaitForSingleObject( event2, 0 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret );
+    CloseHandle( event2 );
+    CloseHandle( event );
+
+    /* waiting threads are woken up both before and after the state moves to the server */
+    event = CreateEventA( NULL, TRUE, FALSE, NULL );
+    thread = CreateThread( NULL, 0, wait_event_thread, event, 0, NULL );
+    Sleep( 50 );
+    SetEvent( event );
+    ret = WaitForSingleObject( thread, 1000 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret );
+    GetExitCodeThread( thread, &ret );
+    ok( ret == WAIT_OBJECT_0, "wait returned %u\n", ret );
+    CloseHandle( thread );
+
+    ResetEvent( event );
+    thread = CreateThread( NULL, 0, wait_event_thread, event, 0, NULL );
+    Sleep( 50 );
+    DuplicateHandle( GetCurrentProcess(), event, GetCurrentProcess(), &event2, 0, FALSE, DUPLICATE_SAME_ACCESS );
+    SetEvent( event2 );
+    ret = WaitForSingleObject( thread, 1000 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret );
+    GetExitCodeThread( thread, &ret );
+    ok( ret == WAIT_OBJECT_0, "wait returned %u\n", ret );
+    CloseHandle( thread );
+    CloseHandle( event2 );
+
+    sem = CreateSemaphoreA( NULL, 2, 3, NULL );
+    ok( sem != NULL, "CreateSemaphore failed with error %u\n", GetLastError() );
+    prev = 0xdeadbeef;
+    ret = ReleaseSemaphore( sem, 1, &prev );
+    ok( ret, "ReleaseSemaphore failed with error %u\n", GetLastError() );
+    ok( prev == 2, "wrong previous count %d\n", prev );
+    SetLastError( 0xdeadbeef );
+    ret = ReleaseSemaphore( sem, 1, NULL );
+    ok( !ret, "ReleaseSemaphore succeeded\n" );
+    ok( GetLastError() == ERROR_TOO_MANY_POSTS, "wrong error %u\n", GetLastError() );
+
+    /* waiting on several objects moves the count to the server */
+    ResetEvent( event );
+    handles[0] = event;
+    handles[1] = sem;
+    ret = WaitForMultipleObjects( 2, handles, FALSE, 0 );
+    ok( ret == WAIT_OBJECT_0 + 1, "WaitForMultipleObjects returned %u\n", ret );
+    ret = WaitForSingleObject( sem, 0 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret );
+    ret = WaitForSingleObject( sem, 0 );
+    ok( ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret );
+    ret = WaitForSingleObject( sem, 0 );
+    ok( ret == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", ret );
+    prev = 0xdeadbeef;
+    ret = ReleaseSemaphore( sem, 3, &prev );
+    ok( ret, "ReleaseSemaphore failed with error %u\n", GetLastError() );
+    ok( prev == 0, "wrong previous count %d\n", prev );
+    CloseHandle( sem );
+    CloseHandle( event );
+}
+
+/* number of timers armed by the timer benchmark, run in interactive mode */
+#define TIMER_STRESS_COUNT 100000
+
+static void test_many_timers(unsigned int count)
+{
+    HANDLE *timers, handle;
+    LARGE_INTEGER due;
+    DWORD start, ret;
+    unsigned int i;
+
+    timers = HeapAlloc(GetProcessHeap(), 0, count * sizeof(*timers));
+
+    /* arm a large number of timers with spread out expiry times, the
+     * first ones expiring well after the test has completed */
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        timers[i] = pCreateWaitableTimerA(NULL, TRUE, NULL);
+        if (!timers[i]) break;
+        due.QuadPart = -(LONGLONG)(3600 + (i * 7919) % count) * 10000000;
+        ret = SetWaitableTimer(timers[i], &due, 0, NULL, NULL, FALSE);
+        if (!ret) break;
+    }
+    ok(i == count, "failed to arm timer %u, error %u\n", i, GetLastError());
+    trace("armed %u timers in %u ms\n", i, GetTickCount() - start);
+
+    /* a short timer still has to fire on time */
+    handle = pCreateWaitableTimerA(NULL, TRUE, NULL);
+    ok(handle != NULL, "CreateWaitableTimer failed with error %u\n", GetLastError());
+    due.QuadPart = -100 * 10000;
+    ret = SetWaitableTimer(handle, &due, 0, NULL, NULL, FALSE);
+    ok(ret, "SetWaitableTimer failed with error %u\n", GetLastError());
+    ret = WaitForSingleObject(handle, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    CloseHandle(handle);
+
+    if (i) ok(WaitForSingleObject(timers[0], 0) == WAIT_TIMEOUT, "long timer is signaled\n");
+
+    start = GetTickCount();
+    while (i--)
+    {
+        CancelWaitableTimer(timers[i]);
+        CloseHandle(timers[i]);
+    }
+    trace("cancelled timers in %u ms\n", GetTickCount() - start);
+
+    HeapFree(GetProcessHeap(), 0, timers);
+}
+
 static void test_waitable_timer(void)
 {
     HANDLE handle, handle2;
@@ -533,6 +672,8 @@ static void test_waitable_timer(void)
         "wrong error %u\n", GetLastError());
 
     CloseHandle( handle );
+
+    test_many_timers( 500 );
 }
 
 static HANDLE sem = 0;
@@ -636,6 +777,54 @@ static void test_iocp_callback(void)
        "Last error is %d\n", GetLastError());
 }
 
+static void test_iocp_batch(void)
+{
+    OVERLAPPED_ENTRY entries[16];
+    HANDLE port;
+    ULONG count, i;
+    BOOL ret;
+
+    if (!pGetQueuedCompletionStatusEx)
+    {
+        win_skip("GetQueuedCompletionStatusEx not available\n");
+        return;
+    }
+
+    port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0);
+    ok(port != NULL, "CreateIoCompletionPort failed: %u\n", GetLastError());
+
+    for (i = 0; i < 10; i++)
+    {
+        ret = PostQueuedCompletionStatus(port, i * 10, i, (OVERLAPPED *)(ULONG_PTR)(i + 1));
+        ok(ret, "PostQueuedCompletionStatus failed: %u\n", GetLastError());
+    }
+
+    count = 0xdeadbeef;
+    ret = pGetQueuedCompletionStatusEx(port, entries, 4, &count, 0, FALSE);
+    ok(ret, "GetQueuedCompletionStatusEx failed: %u\n", GetLastError());
+    ok(count == 4, "got %u entries\n", count);
+    for (i = 0; i < count; i++)
+    {
+        ok(entries[i].lpCompletionKey == i, "%u: got key %u\n", i, (DWORD)entries[i].lpCompletionKey);
+        ok(entries[i].lpOverlapped == (OVERLAPPED *)(ULONG_PTR)(i + 1), "%u: got overlapped %p\n", i, entries[i].lpOverlapped);
+        ok(entries[i].dwNumberOfBytesTransferred == i * 10, "%u: got %u bytes\n", i, entries[i].dwNumberOfBytesTransferred);
+    }
+
+    count = 0xdeadbeef;
+    ret = pGetQueuedCompletionStatusEx(port, entries, 16, &count, 0, FALSE);
+    ok(ret, "GetQueuedCompletionStatusEx failed: %u\n", GetLastError());
+    ok(count == 6, "got %u entries\n", count);
+    for (i = 0; i < count; i++)
+        ok(entries[i].lpCompletionKey == i + 4, "%u: got key %u\n", i, (DWORD)entries[i].lpCompletionKey);
+
+    SetLastError(0xdeadbeef);
+    ret = pGetQueuedCompletionStatusEx(port, entries, 16, &count, 0, FALSE);
+    ok(!ret, "GetQueuedCompletionStatusEx succeeded\n");
+    ok(GetLastError() == WAIT_TIMEOUT, "got error %u\n", GetLastError());
+
+    CloseHandle(port);
+}
+
 static void CALLBACK timer_queue_cb1(PVOID p, BOOLEAN timedOut)
 {
     int *pn = p;
@@ -1140,11 +1329,16 @@ static void test_WaitForSingleObject(void)
     CloseHandle(nonsignaled);
 }
 
+static DWORD WINAPI wait_multiple_thread(void *arg)
+{
+    return WaitForMultipleObjects(MAXIMUM_WAIT_OBJECTS, arg, FALSE, 5000);
+}
+
 static void test_WaitForMultipleObjects(void)
 {
     DWORD r;
     int i;
-    HANDLE maxevents[MAXIMUM_WAIT_OBJECTS];
+    HANDLE maxevents[MAXIMUM_WAIT_OBJECTS], thread;
 
     /* create the maximum number of events and make sure
      * we can wait on that many */
@@ -1184,6 +1378,22 @@ static void test_WaitForMultipleObjects(void)
         ok( r == WAIT_OBJECT_0+i, "should signal handle #%d first, got %d\n", i, r);
     }
 
+    /* wake up a blocked waiter through a single object */
+    for (i=MAXIMUM_WAIT_OBJECTS-1; i>=0; i-=7)
+    {
+        thread = CreateThread(NULL, 0, wait_multiple_thread, maxevents, 0, NULL);
+        ok(thread != NULL, "CreateThread failed: %u\n", GetLastError());
+        r = WaitForSingleObject(thread, 50);
+        ok(r == WAIT_TIMEOUT, "thread should be waiting, got %u\n", r);
+        SetEvent(maxevents[i]);
+        r = WaitForSingleObject(thread, 5000);
+        ok(r == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", r);
+        GetExitCodeThread(thread, &r);
+        ok(r == WAIT_OBJECT_0+i, "expected handle #%d, got %d\n", i, r);
+        CloseHandle(thread);
+        if (!i) ResetEvent(maxevents[0]);
+    }
+
     for (i=0; i<MAXIMUM_WAIT_OBJECTS; i++)
         if (maxevents[i]) CloseHandle(maxevents[i]);
 }
@@ -2303,6 +2513,75 @@ static void test_srwlock_example(void)
     trace("number of total exclusive accesses is %d\n", srwlock_protected_value);
 }
 
+static SRWLOCK srwlock_contention;
+static volatile LONG srwlock_contention_value;
+static LONG srwlock_contention_errors;
+
+#define SRWLOCK_CONTENTION_THREADS 4
+#define SRWLOCK_CONTENTION_LOOPS   100000
+
+static DWORD WINAPI srwlock_contention_thread(LPVOID x)
+{
+    LONG old;
+    int i;
+
+    for (i = 0; i < SRWLOCK_CONTENTION_LOOPS; i++)
+    {
+        if (i % 4)
+        {
+            pAcquireSRWLockExclusive(&srwlock_contention);
+            old = srwlock_contention_value;
+            srwlock_contention_value = old + 1;
+            pReleaseSRWLockExclusive(&srwlock_contention);
+        }
+        else
+        {
+            pAcquireSRWLockShared(&srwlock_contention);
+            old = srwlock_contention_value;
+            Sleep(0);
+            if (old != srwlock_contention_value)
+                InterlockedIncrement(&srwlock_contention_errors);
+            pReleaseSRWLockShared(&srwlock_contention);
+        }
+    }
+
+    return 0;
+}
+
+static void test_srwlock_contention(void)
+{
+    HANDLE threads[SRWLOCK_CONTENTION_THREADS];
+    DWORD dummy, start, ret;
+    int i;
+
+    if (!pInitializeSRWLock)
+    {
+        /* function is not yet in XP, only in newer Windows */
+        win_skip("no srw lock support.\n");
+        return;
+    }
+
+    pInitializeSRWLock(&srwlock_contention);
+    srwlock_contention_value = srwlock_contention_errors = 0;
+
+    start = GetTickCount();
+    for (i = 0; i < SRWLOCK_CONTENTION_THREADS; i++)
+        threads[i] = CreateThread(NULL, 0, srwlock_contention_thread, NULL, 0, &dummy);
+    ret = WaitForMultipleObjects(SRWLOCK_CONTENTION_THREADS, threads, TRUE, 60000);
+    ok(ret == WAIT_OBJECT_0, "WaitForMultipleObjects returned %u\n", ret);
+    for (i = 0; i < SRWLOCK_CONTENTION_THREADS; i++)
+        CloseHandle(threads[i]);
+
+    ok(srwlock_contention_value == SRWLOCK_CONTENTION_THREADS * SRWLOCK_CONTENTION_LOOPS / 4 * 3,
+       "got %d exclusive accesses\n", srwlock_contention_value);
+    ok(!srwlock_contention_errors, "value changed under a shared lock %d times\n",
+       srwlock_contention_errors);
+
+    trace("%u lock operations by %u threads took %u ms\n",
+          SRWLOCK_CONTENTION_THREADS * SRWLOCK_CONTENTION_LOOPS, SRWLOCK_CONTENTION_THREADS,
+          GetTickCount() - start);
+}
+
 START_TEST(sync)
 {
     HMODULE hdll = GetModuleHandleA("kernel32.dll");
@@ -2334,14 +2613,18 @@ START_TEST(sync)
     pTryAcquireSRWLockExclusive = (void *)GetProcAddress(hdll, "TryAcquireSRWLockExclusive");
     pTryAcquireSRWLockShared = (void *)GetProcAddress(hdll, "TryAcquireSRWLockShared");
     pNtWaitForMultipleObjects = (void *)GetProcAddress(hntdll, "NtWaitForMultipleObjects");
+    pGetQueuedCompletionStatusEx = (void *)GetProcAddress(hdll, "GetQueuedCompletionStatusEx");
 
     test_signalandwait();
     test_mutex();
     test_slist();
     test_event();
     test_semaphore();
+    test_unnamed_sync_objects();
     test_waitable_timer();
+    if (winetest_interactive && pCreateWaitableTimerA) test_many_timers( TIMER_STRESS_COUNT );
     test_iocp_callback();
+    test_iocp_batch();
     test_timer_queue();
     test_WaitForSingleObject();
     test_WaitForMultipleObjects();
@@ -2350,4 +2633,5 @@ START_TEST(sync)
     test_condvars_consumer_producer();
     test_srwlock_base();
     test_srwlock_example();
+    test_srwlock_contention();
 }
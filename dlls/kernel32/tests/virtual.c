@@ -366,6 +366,44 @@ static void test_VirtualAlloc(void)
     ok(VirtualFree(addr1, 0, MEM_RELEASE), "VirtualFree failed\n");
 }
 
+static void test_VirtualAlloc_many(void)
+{
+    MEMORY_BASIC_INFORMATION info;
+    static char *ptrs[1000];
+    unsigned int i, count;
+    SIZE_T size;
+
+    for (count = 0; count < sizeof(ptrs) / sizeof(ptrs[0]); count++)
+    {
+        ptrs[count] = VirtualAlloc( NULL, 0x10000 * (1 + count % 3), MEM_RESERVE, PAGE_NOACCESS );
+        ok( ptrs[count] != NULL, "VirtualAlloc failed %u\n", GetLastError() );
+        if (!ptrs[count]) break;
+    }
+
+    /* release every other allocation and check that the others are still there */
+    for (i = 0; i < count; i += 2)
+        ok( VirtualFree( ptrs[i], 0, MEM_RELEASE ), "VirtualFree failed %u\n", GetLastError() );
+
+    for (i = 0; i < count; i++)
+    {
+        size = VirtualQuery( ptrs[i] + 0x1000, &info, sizeof(info) );
+        ok( size == sizeof(info), "VirtualQuery failed %u\n", GetLastError() );
+        if (i % 2)
+        {
+            ok( info.AllocationBase == ptrs[i], "%u: wrong allocation base %p / %p\n",
+                i, info.AllocationBase, ptrs[i] );
+            ok( info.State == MEM_RESERVE, "%u: wrong state %x\n", i, info.State );
+            ok( info.RegionSize == 0x10000 * (1 + i % 3) - 0x1000, "%u: wrong size %lx\n",
+                i, info.RegionSize );
+        }
+        else ok( info.State == MEM_FREE || info.AllocationBase != ptrs[i],
+                 "%u: allocation %p not released\n", i, ptrs[i] );
+    }
+
+    for (i = 1; i < count; i += 2)
+        ok( VirtualFree( ptrs[i], 0, MEM_RELEASE ), "VirtualFree failed %u\n", GetLastError() );
+}
+
 static void test_MapViewOfFile(void)
 {
     static const char testfile[] = "testfile.xxx";
@@ -2592,6 +2630,7 @@ START_TEST(virtual)
     test_VirtualProtect();
     test_VirtualAllocEx();
     test_VirtualAlloc();
+    test_VirtualAlloc_many();
     test_MapViewOfFile();
     test_NtMapViewOfSection();
     test_NtAreMappedFilesTheSame();
@@ -84,6 +84,7 @@ typedef struct
 /* Value for arena 'magic' field */
 #define ARENA_INUSE_MAGIC      0x455355
 #define ARENA_PENDING_MAGIC    0xbedead
+#define ARENA_CACHED_MAGIC     0x484341
 #define ARENA_FREE_MAGIC       0x45455246
 #define ARENA_LARGE_MAGIC      0x6752614c
 
@@ -114,6 +115,14 @@ C_ASSERT( sizeof(ARENA_LARGE) % LARGE_ALIGNMENT == 0 );
 #define HEAP_TAIL_EXTRA_SIZE(flags) \
     ((flags & HEAP_TAIL_CHECKING_ENABLED) || RUNNING_ON_VALGRIND ? ALIGNMENT : 0)
 
+/* max data size of the blocks kept on the lookaside lists */
+#define HEAP_LOOKASIDE_MAX_SIZE  0x400
+#define HEAP_NB_LOOKASIDE        (HEAP_LOOKASIDE_MAX_SIZE / ALIGNMENT + 1)
+/* max number of blocks on each lookaside list */
+#define HEAP_LOOKASIDE_DEPTH     128
+/* max number of sub-heaps whose blocks can be put on the lookaside lists */
+#define HEAP_LOOKASIDE_RANGES    16
+
 /* Max size of the blocks on the free lists */
 static const SIZE_T HEAP_freeListSizes[] =
 {
@@ -143,6 +152,13 @@ typedef struct tagSUBHEAP
 
 #define SUBHEAP_MAGIC    ((DWORD)('S' | ('U'<<8) | ('B'<<16) | ('H'<<24)))
 
+/* address range of the blocks of a sub-heap, readable without holding the heap lock */
+struct lookaside_range
+{
+    const char * volatile start;    /* address of the first block */
+    const char * volatile end;      /* end of the sub-heap, NULL if the range is unused */
+};
+
 typedef struct tagHEAP
 {
     DWORD_PTR        unknown1[2];
@@ -159,6 +175,8 @@ typedef struct tagHEAP
     ARENA_INUSE    **pending_free;  /* Ring buffer for pending free requests */
     RTL_CRITICAL_SECTION critSection; /* Critical section for serialization */
     FREE_LIST_ENTRY *freeList;      /* Free lists */
+    SLIST_HEADER    *lookaside;     /* Lock-free lists of recently freed small blocks */
+    struct lookaside_range lookaside_ranges[HEAP_LOOKASIDE_RANGES]; /* Sub-heaps known to the lookaside lists */
 } HEAP;
 
 #define HEAP_MAGIC       ((DWORD)('H' | ('E'<<8) | ('A'<<16) | ('P'<<24)))
@@ -290,13 +308,132 @@ static void subheap_notify_free_all(SUBHEAP const *subheap)
         {
             ARENA_INUSE const *pArena = (ARENA_INUSE const *)ptr;
             if (pArena->magic == ARENA_INUSE_MAGIC) notify_free(pArena + 1);
-            else if (pArena->magic != ARENA_PENDING_MAGIC) ERR("bad inuse_magic @%p\n", pArena);
+            else if (pArena->magic != ARENA_PENDING_MAGIC && pArena->magic != ARENA_CACHED_MAGIC)
+                ERR("bad inuse_magic @%p\n", pArena);
             ptr += sizeof(*pArena) + (pArena->size & ARENA_SIZE_MASK);
         }
     }
 #endif
 }
 
+/* get the lookaside list for a given block size, or NULL if it's too large to be cached */
+static inline SLIST_HEADER *get_lookaside_list( HEAP *heap, SIZE_T size )
+{
+    if (size > ROUND_SIZE( HEAP_LOOKASIDE_MAX_SIZE )) return NULL;
+    return &heap->lookaside[(size - ARENA_OFFSET) / ALIGNMENT];
+}
+
+/* try to get a block of the exact given size from the lookaside lists, without locking the heap */
+static inline ARENA_INUSE *lookaside_pop( HEAP *heap, SIZE_T size )
+{
+    SLIST_HEADER *list;
+    ARENA_INUSE *arena;
+    SLIST_ENTRY *entry;
+
+    if (!(list = get_lookaside_list( heap, size ))) return NULL;
+    if (!(entry = RtlInterlockedPopEntrySList( list ))) return NULL;
+    arena = (ARENA_INUSE *)entry - 1;
+    arena->magic = ARENA_INUSE_MAGIC;
+    return arena;
+}
+
+/* record the address range of a new sub-heap; heap lock must be held */
+static void lookaside_add_range( HEAP *heap, SUBHEAP *subheap )
+{
+    struct lookaside_range *range;
+
+    /* blocks of the sub-heaps that don't fit go through the locked path */
+    for (range = heap->lookaside_ranges; range < heap->lookaside_ranges + HEAP_LOOKASIDE_RANGES; range++)
+    {
+        if (range->end) continue;
+        range->start = (const char *)subheap->base + subheap->headerSize;
+        interlocked_xchg_ptr( (void **)&range->end, (char *)subheap->base + subheap->size );
+        return;
+    }
+}
+
+/* forget the address range of a sub-heap that is being freed; heap lock must be held */
+static void lookaside_remove_range( HEAP *heap, SUBHEAP *subheap )
+{
+    struct lookaside_range *range;
+
+    for (range = heap->lookaside_ranges; range < heap->lookaside_ranges + HEAP_LOOKASIDE_RANGES; range++)
+    {
+        if (range->start != (const char *)subheap->base + subheap->headerSize) continue;
+        interlocked_xchg_ptr( (void **)&range->end, NULL );
+        range->start = NULL;
+        return;
+    }
+}
+
+/* check that a block lies in one of the heap sub-heaps, without locking the heap */
+static inline BOOL lookaside_owns_block( HEAP *heap, const ARENA_INUSE *arena )
+{
+    const struct lookaside_range *range;
+    const char *start, *end;
+
+    for (range = heap->lookaside_ranges; range < heap->lookaside_ranges + HEAP_LOOKASIDE_RANGES; range++)
+    {
+        if (!(end = range->end)) continue;
+        start = range->start;
+        /* the range may have been replaced while reading it */
+        if ((const char *)arena >= start && (const char *)(arena + 1) <= end && range->end == end)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* try to put a freed block on the lookaside lists, without locking the heap */
+static inline BOOL lookaside_push( HEAP *heap, ARENA_INUSE *arena )
+{
+    SLIST_HEADER *list;
+
+    if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET) return FALSE;
+    /* blocks from other heaps must go through the validated path */
+    if (!lookaside_owns_block( heap, arena )) return FALSE;
+    if (arena->magic != ARENA_INUSE_MAGIC || (arena->size & ARENA_FLAG_FREE)) return FALSE;
+    if (!(list = get_lookaside_list( heap, arena->size & ARENA_SIZE_MASK ))) return FALSE;
+    if (RtlQueryDepthSList( list ) >= HEAP_LOOKASIDE_DEPTH) return FALSE;
+    arena->magic = ARENA_CACHED_MAGIC;
+    RtlInterlockedPushEntrySList( list, (SLIST_ENTRY *)(arena + 1) );
+    return TRUE;
+}
+
+/* enable the lookaside lists front-end for a heap */
+static NTSTATUS enable_lookaside( HEAP *heap )
+{
+    SIZE_T size = HEAP_NB_LOOKASIDE * sizeof(SLIST_HEADER);
+    void *ptr = NULL;
+    NTSTATUS status;
+    unsigned int i;
+
+    if (heap->lookaside) return STATUS_SUCCESS;
+    /* blocks on the lookaside lists would escape the heap checks */
+    if ((heap->flags & (HEAP_NO_SERIALIZE | HEAP_TAIL_CHECKING_ENABLED | HEAP_FREE_CHECKING_ENABLED |
+                        HEAP_VALIDATE | HEAP_VALIDATE_ALL | HEAP_VALIDATE_PARAMS)) ||
+        heap->pending_free || RUNNING_ON_VALGRIND)
+        return STATUS_UNSUCCESSFUL;
+
+    if ((status = NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, 4, &size, MEM_COMMIT, PAGE_READWRITE )))
+        return status;
+    for (i = 0; i < HEAP_NB_LOOKASIDE; i++) RtlInitializeSListHead( (SLIST_HEADER *)ptr + i );
+
+    RtlEnterCriticalSection( &heap->critSection );
+    if (!heap->lookaside)
+    {
+        heap->lookaside = ptr;
+        ptr = NULL;
+    }
+    RtlLeaveCriticalSection( &heap->critSection );
+
+    if (ptr)
+    {
+        size = 0;
+        NtFreeVirtualMemory( NtCurrentProcess(), &ptr, &size, MEM_RELEASE );
+    }
+    return STATUS_SUCCESS;
+}
+
 /* locate a free list entry of the appropriate size */
 /* size is the size of the whole block including the arena header */
 static inline unsigned int get_freelist_index( SIZE_T size )
@@ -377,7 +514,8 @@ static void HEAP_Dump( HEAP *heap )
             {
                 ARENA_INUSE *pArena = (ARENA_INUSE *)ptr;
                 DPRINTF( "%p %08x %s %08x\n",
-                         pArena, pArena->magic, pArena->magic == ARENA_INUSE_MAGIC ? "used" : "pend",
+                         pArena, pArena->magic, pArena->magic == ARENA_INUSE_MAGIC ? "used" :
+                         pArena->magic == ARENA_CACHED_MAGIC ? "cach" : "pend",
                          pArena->size & ARENA_SIZE_MASK );
                 ptr += sizeof(*pArena) + (pArena->size & ARENA_SIZE_MASK);
                 arenaSize += sizeof(ARENA_INUSE);
@@ -670,6 +808,7 @@ static void HEAP_MakeInUseBlockFree( SUBHEAP *subheap, ARENA_INUSE *pArena )
         list_remove( &pFree->entry );
         /* Remove the subheap from the list */
         list_remove( &subheap->entry );
+        lookaside_remove_range( subheap->heap, subheap );
         /* Free the memory */
         subheap->magic = 0;
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
@@ -906,6 +1045,7 @@ static SUBHEAP *HEAP_CreateSubHeap( HEAP *heap, LPVOID address, DWORD flags,
         subheap->magic      = SUBHEAP_MAGIC;
         subheap->headerSize = ROUND_SIZE( sizeof(SUBHEAP) );
         list_add_head( &heap->subheap_list, &subheap->entry );
+        lookaside_add_range( heap, subheap );
     }
     else
     {
@@ -939,6 +1079,7 @@ static SUBHEAP *HEAP_CreateSubHeap( HEAP *heap, LPVOID address, DWORD flags,
             pEntry->arena.magic = ARENA_FREE_MAGIC;
             if (i) list_add_after( &pEntry[-1].arena.entry, &pEntry->arena.entry );
         }
+        lookaside_add_range( heap, subheap );
 
         /* Initialize critical section */
 
@@ -1204,7 +1345,8 @@ static BOOL HEAP_ValidateInUseArena( const SUBHEAP *subheap, const ARENA_INUSE *
     }
 
     /* Check magic number */
-    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC)
+    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC &&
+        pArena->magic != ARENA_CACHED_MAGIC)
     {
         if (quiet == NOISY) {
             ERR("Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, pArena->magic, pArena );
@@ -1419,7 +1561,7 @@ static BOOL validate_block_pointer( HEAP *heap, SUBHEAP **ret_subheap, const ARE
         ret = HEAP_ValidateInUseArena( subheap, arena, QUIET );
     else if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET)
         WARN( "Heap %p: unaligned arena pointer %p\n", subheap->heap, arena );
-    else if (arena->magic == ARENA_PENDING_MAGIC)
+    else if (arena->magic == ARENA_PENDING_MAGIC || arena->magic == ARENA_CACHED_MAGIC)
         WARN( "Heap %p: block %p used after free\n", subheap->heap, arena + 1 );
     else if (arena->magic != ARENA_INUSE_MAGIC)
         WARN( "Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, arena->magic, arena );
@@ -1628,6 +1770,12 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
         addr = heapPtr->pending_free;
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
     }
+    if (heapPtr->lookaside)
+    {
+        size = 0;
+        addr = heapPtr->lookaside;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    }
     size = 0;
     addr = heapPtr->subheap.base;
     NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
@@ -1673,6 +1821,14 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+    if (heapPtr->lookaside && (pInUse = lookaside_pop( heapPtr, rounded_size )))
+    {
+        pInUse->unused_bytes = (pInUse->size & ARENA_SIZE_MASK) - size;
+        initialize_block( pInUse + 1, size, pInUse->unused_bytes, flags );
+        TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, pInUse + 1 );
+        return pInUse + 1;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
@@ -1756,13 +1912,20 @@ BOOLEAN WINAPI RtlFreeHeap( HANDLE heap, ULONG flags, PVOID ptr )
 
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
+
+    pInUse  = (ARENA_INUSE *)ptr - 1;
+    if (heapPtr->lookaside && lookaside_push( heapPtr, pInUse ))
+    {
+        TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
+        return TRUE;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     /* Inform valgrind we are trying to free memory, so it can throw up an error message */
     notify_free( ptr );
 
     /* Some sanity checks */
-    pInUse  = (ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pInUse )) goto error;
 
     if (!subheap)
@@ -2123,7 +2286,8 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         }
 
         if (((ARENA_INUSE *)ptr - 1)->magic == ARENA_INUSE_MAGIC ||
-            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC)
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC ||
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_CACHED_MAGIC)
         {
             ARENA_INUSE *pArena = (ARENA_INUSE *)ptr - 1;
             ptr += pArena->size & ARENA_SIZE_MASK;
@@ -2236,6 +2400,8 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
+    HEAP *heapPtr;
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
@@ -2244,7 +2410,8 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+        *(ULONG *)info = heapPtr->lookaside ? 2 /* low fragmentation heap */ : 0 /* standard heap */;
         return STATUS_SUCCESS;
 
     default:
@@ -2252,3 +2419,173 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         return STATUS_INVALID_INFO_CLASS;
     }
 }
+
+/***********************************************************************
+ *           RtlSetHeapInformation    (NTDLL.@)
+ */
+NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
+                                       PVOID info, SIZE_T size )
+{
+    HEAP *heapPtr;
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+
+        switch (*(ULONG *)info)
+        {
+        case 0:  /* standard heap, can't be restored once the lookaside lists are in use */
+            return heapPtr->lookaside ? STATUS_UNSUCCESSFUL : STATUS_SUCCESS;
+        case 2:  /* low fragmentation heap */
+            return enable_lookaside( heapPtr );
+        default:
+            return STATUS_UNSUCCESSFUL;
+        }
+
+    default:
+        FIXME("%p %u %p %lu: stub\n", heap, info_class, info, size);
+        return STATUS_SUCCESS;
+    }
+}
+
+struct heap_stats
+{
+    SIZE_T committed;       /* committed size of the sub-heaps and large blocks */
+    SIZE_T reserved;        /* reserved size of the sub-heaps and large blocks */
+    SIZE_T in_use;          /* size of the blocks in use */
+    SIZE_T cached;          /* size of the blocks on the lookaside lists or pending free */
+    SIZE_T free;            /* size of the free blocks */
+    SIZE_T largest_free;    /* size of the largest free block */
+    SIZE_T large_size;      /* size of the large blocks in use */
+    ULONG  subheaps;        /* number of sub-heaps */
+    ULONG  large_blocks;    /* number of large blocks */
+    ULONG  contention;      /* number of times a thread had to wait for the heap lock */
+    ULONG  in_use_blocks[HEAP_NB_FREE_LISTS];  /* blocks in use per size class */
+    ULONG  free_blocks[HEAP_NB_FREE_LISTS];    /* free blocks per size class */
+};
+
+/* collect the heap statistics; the heap lock must be held */
+static void get_heap_stats( HEAP *heap, struct heap_stats *stats )
+{
+    SUBHEAP *subheap;
+    ARENA_LARGE *large;
+
+    memset( stats, 0, sizeof(*stats) );
+
+    LIST_FOR_EACH_ENTRY( subheap, &heap->subheap_list, SUBHEAP, entry )
+    {
+        char *ptr = (char *)subheap->base + subheap->headerSize;
+
+        stats->subheaps++;
+        stats->committed += subheap->commitSize;
+        stats->reserved += subheap->size;
+        while (ptr < (char *)subheap->base + subheap->size)
+        {
+            if (*(DWORD *)ptr & ARENA_FLAG_FREE)
+            {
+                ARENA_FREE *arena = (ARENA_FREE *)ptr;
+                SIZE_T size = arena->size & ARENA_SIZE_MASK;
+
+                stats->free_blocks[get_freelist_index( size + sizeof(*arena) )]++;
+                stats->free += size;
+                if (size > stats->largest_free) stats->largest_free = size;
+                ptr += sizeof(*arena) + size;
+            }
+            else
+            {
+                ARENA_INUSE *arena = (ARENA_INUSE *)ptr;
+                SIZE_T size = arena->size & ARENA_SIZE_MASK;
+
+                if (arena->magic == ARENA_INUSE_MAGIC)
+                {
+                    stats->in_use_blocks[get_freelist_index( size + sizeof(ARENA_FREE) )]++;
+                    stats->in_use += size - arena->unused_bytes;
+                }
+                else stats->cached += size;
+                ptr += sizeof(*arena) + size;
+            }
+        }
+    }
+
+    LIST_FOR_EACH_ENTRY( large, &heap->large_list, ARENA_LARGE, entry )
+    {
+        stats->large_blocks++;
+        stats->large_size += large->data_size;
+        stats->committed += large->block_size;
+        stats->reserved += large->block_size;
+    }
+    stats->in_use += stats->large_size;
+
+    if (heap->critSection.DebugInfo) stats->contention = heap->critSection.DebugInfo->ContentionCount;
+}
+
+/***********************************************************************
+ *           RtlUsageHeap    (NTDLL.@)
+ */
+NTSTATUS WINAPI RtlUsageHeap( HANDLE heap, ULONG flags, RTL_HEAP_USAGE *usage )
+{
+    struct heap_stats stats;
+    HEAP *heapPtr;
+
+    if (!usage || usage->Length != sizeof(*usage)) return STATUS_INFO_LENGTH_MISMATCH;
+    if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_PARAMETER;
+
+    flags &= HEAP_NO_SERIALIZE;
+    flags |= heapPtr->flags;
+    if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
+    get_heap_stats( heapPtr, &stats );
+    if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+
+    usage->BytesAllocated = stats.in_use;
+    usage->BytesCommitted = stats.committed;
+    usage->BytesReserved = stats.reserved;
+    usage->BytesReservedMaximum = (heapPtr->flags & HEAP_GROWABLE) ? 0 : stats.reserved;
+    return STATUS_SUCCESS;
+}
+
+static void dump_heap_stats( HEAP *heap )
+{
+    struct heap_stats stats;
+    unsigned int i;
+
+    RtlEnterCriticalSection( &heap->critSection );
+    get_heap_stats( heap, &stats );
+    RtlLeaveCriticalSection( &heap->critSection );
+
+    MESSAGE( "heap %p: flags %08x committed %lu reserved %lu in use %lu free %lu cached %lu\n",
+             heap, heap->flags, stats.committed, stats.reserved, stats.in_use, stats.free, stats.cached );
+    /* external fragmentation: share of the free space that can't be used for the largest request */
+    MESSAGE( "heap %p: subheaps %u large blocks %u (%lu bytes) contention %u fragmentation %lu%%\n",
+             heap, stats.subheaps, stats.large_blocks, stats.large_size, stats.contention,
+             stats.free ? (stats.free - stats.largest_free) * 100 / stats.free : 0 );
+    for (i = 0; i < HEAP_NB_FREE_LISTS; i++)
+    {
+        if (!stats.in_use_blocks[i] && !stats.free_blocks[i]) continue;
+        if (i < HEAP_NB_FREE_LISTS - 1)
+            MESSAGE( "heap %p:   size <= %-5lu used %u free %u\n",
+                     heap, HEAP_freeListSizes[i], stats.in_use_blocks[i], stats.free_blocks[i] );
+        else
+            MESSAGE( "heap %p:   size >  %-5lu used %u free %u\n",
+                     heap, HEAP_freeListSizes[i - 1], stats.in_use_blocks[i], stats.free_blocks[i] );
+    }
+}
+
+/***********************************************************************
+ *           heap_dump_statistics
+ *
+ * Print the statistics of all the process heaps. Used at process exit
+ * when WINEHEAPSTATS is set, independently of the debug channels.
+ */
+void heap_dump_statistics(void)
+{
+    HEAP *heap;
+
+    if (!processHeap || !getenv( "WINEHEAPSTATS" )) return;
+
+    RtlEnterCriticalSection( &processHeap->critSection );
+    dump_heap_stats( processHeap );
+    LIST_FOR_EACH_ENTRY( heap, &processHeap->entry, HEAP, entry ) dump_heap_stats( heap );
+    RtlLeaveCriticalSection( &processHeap->critSection );
+}
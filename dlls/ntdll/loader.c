@@ -2539,6 +2539,7 @@ void WINAPI LdrShutdownProcess(void)
     TRACE("()\n");
     process_detaching = TRUE;
     process_detach();
+    heap_dump_statistics();
 }
 
 
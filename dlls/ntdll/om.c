@@ -335,7 +335,9 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source,
             if (reply->closed && reply->self)
             {
                 int fd = server_remove_fd_from_cache( source );
+                int fast_slot = remove_fast_sync_handle( source );
                 if (fd != -1) close( fd );
+                if (fast_slot != -1) free_fast_sync_slot( fast_slot );
             }
         }
     }
@@ -348,6 +350,7 @@ NTSTATUS close_handle( HANDLE handle )
 {
     NTSTATUS ret;
     int fd = server_remove_fd_from_cache( handle );
+    int fast_slot = remove_fast_sync_handle( handle );
 
     SERVER_START_REQ( close_handle )
     {
@@ -356,6 +359,8 @@ NTSTATUS close_handle( HANDLE handle )
     }
     SERVER_END_REQ;
     if (fd != -1) close( fd );
+    /* on success the server no longer uses the slot */
+    if (fast_slot != -1 && !ret) free_fast_sync_slot( fast_slot );
     return ret;
 }
 
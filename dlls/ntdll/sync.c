@@ -42,6 +42,10 @@
 #ifdef HAVE_SCHED_H
 # include <sched.h>
 #endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
+#include <limits.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -144,6 +148,353 @@ void NTDLL_free_struct_sd(struct security_descriptor *server_sd)
     RtlFreeHeap(GetProcessHeap(), 0, server_sd);
 }
 
+/*
+ *	Fast synchronization objects
+ *
+ * Unnamed and non-inheritable events and semaphores that are created with
+ * full access keep their state in a slot of a section shared with the
+ * server, so that setting them, querying them and waiting on them alone can
+ * be done with futexes, without a server round trip. The server object
+ * still exists; as soon as the server needs the state itself (waits on
+ * several objects, alertable waits, asynchronous I/O, other handles to the
+ * same object, ...) it takes it over and leaves FAST_SYNC_SERVER in the
+ * slot, and all the calls then go through the server again.
+ */
+
+#define FAST_SYNC_SLOTS       8192
+#define FAST_SYNC_BLOCK_SIZE  (65536 / sizeof(struct fast_sync_entry))
+#define FAST_SYNC_BLOCKS      128
+
+enum fast_sync_type
+{
+    FAST_SYNC_ANY,
+    FAST_SYNC_EVENT,
+    FAST_SYNC_SEMAPHORE
+};
+
+struct fast_sync_entry
+{
+    int  slot;          /* slot index + 1, 0 if the handle is not a fast object */
+    int  type;          /* type of the object */
+    int  max;           /* maximum count, 1 for events */
+    int  manual_reset;  /* manual reset event */
+};
+
+static struct fast_sync_slot *fast_sync_slots;  /* slots shared with the server */
+static BOOL fast_sync_failed;
+static unsigned int fast_sync_used;  /* number of slots handed out so far */
+static unsigned int fast_sync_free[FAST_SYNC_SLOTS];  /* freed slots, oldest first */
+static unsigned int fast_sync_free_head, fast_sync_free_tail;
+static struct fast_sync_entry *fast_sync_table[FAST_SYNC_BLOCKS];
+
+static RTL_CRITICAL_SECTION fast_sync_section;
+static RTL_CRITICAL_SECTION_DEBUG fast_sync_critsect_debug =
+{
+    0, 0, &fast_sync_section,
+    { &fast_sync_critsect_debug.ProcessLocksList, &fast_sync_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": fast_sync_section") }
+};
+static RTL_CRITICAL_SECTION fast_sync_section = { &fast_sync_critsect_debug, -1, 0, 0, 0, 0 };
+
+#ifdef __linux__
+
+/* the slots are shared with the server, so these can't be private futexes */
+
+static inline BOOL fast_sync_futex_supported(void)
+{
+    static int supported = -1;
+
+    if (supported == -1)
+        supported = syscall( __NR_futex, &supported, 1 /*FUTEX_WAKE*/, 0, NULL, 0, 0 ) != -1 || errno != ENOSYS;
+    return supported;
+}
+
+static inline void fast_sync_futex_wait( int *addr, int val, struct timespec *timeout )
+{
+    syscall( __NR_futex, addr, 0 /*FUTEX_WAIT*/, val, timeout, 0, 0 );
+}
+
+static inline void fast_sync_futex_wake( int *addr, int val )
+{
+    syscall( __NR_futex, addr, 1 /*FUTEX_WAKE*/, val, NULL, 0, 0 );
+}
+
+#else
+
+static inline BOOL fast_sync_futex_supported(void)
+{
+    return FALSE;
+}
+
+static inline void fast_sync_futex_wait( int *addr, int val, struct timespec *timeout )
+{
+}
+
+static inline void fast_sync_futex_wake( int *addr, int val )
+{
+}
+
+#endif
+
+static inline unsigned int fast_sync_handle_to_index( HANDLE handle, unsigned int *block )
+{
+    unsigned int idx = (wine_server_obj_handle(handle) >> 2) - 1;
+    *block = idx / FAST_SYNC_BLOCK_SIZE;
+    return idx % FAST_SYNC_BLOCK_SIZE;
+}
+
+/***********************************************************************
+ *           init_fast_sync
+ *
+ * Caller must hold fast_sync_section.
+ */
+static BOOL init_fast_sync(void)
+{
+    LARGE_INTEGER size;
+    SIZE_T view_size = 0;
+    HANDLE section;
+    void *ptr = NULL;
+    NTSTATUS status;
+
+    if (fast_sync_slots) return TRUE;
+    if (fast_sync_failed) return FALSE;
+    fast_sync_failed = TRUE;
+
+    size.QuadPart = FAST_SYNC_SLOTS * sizeof(struct fast_sync_slot);
+    if (NtCreateSection( &section, SECTION_ALL_ACCESS, NULL, &size, PAGE_READWRITE, SEC_COMMIT, 0 ))
+        return FALSE;
+    if (!NtMapViewOfSection( section, NtCurrentProcess(), &ptr, 0, 0, NULL, &view_size,
+                             ViewShare, 0, PAGE_READWRITE ))
+    {
+        SERVER_START_REQ( init_fast_sync )
+        {
+            req->handle = wine_server_obj_handle( section );
+            req->count  = FAST_SYNC_SLOTS;
+            status = wine_server_call( req );
+        }
+        SERVER_END_REQ;
+        if (!status)
+        {
+            fast_sync_slots = ptr;
+            fast_sync_failed = FALSE;
+        }
+        else NtUnmapViewOfSection( NtCurrentProcess(), ptr );
+    }
+    NtClose( section );
+    return !fast_sync_failed;
+}
+
+/***********************************************************************
+ *           alloc_fast_sync_slot
+ *
+ * Allocate a slot for a new event or semaphore, if it qualifies.
+ */
+static int alloc_fast_sync_slot( const OBJECT_ATTRIBUTES *attr, ACCESS_MASK access,
+                                 ACCESS_MASK all_access, int value )
+{
+    int index = -1;
+
+    if (attr && ((attr->ObjectName && attr->ObjectName->Length) || (attr->Attributes & OBJ_INHERIT)))
+        return -1;
+    if ((access & all_access) != all_access && !(access & GENERIC_ALL)) return -1;
+    /* critical sections would need a semaphore to wait without futexes */
+    if (fast_sync_failed || !fast_sync_futex_supported()) return -1;
+
+    RtlEnterCriticalSection( &fast_sync_section );
+    if (init_fast_sync())
+    {
+        /* reuse the oldest freed slots last, so that stale users are unlikely to see a new object */
+        if (fast_sync_used < FAST_SYNC_SLOTS) index = fast_sync_used++;
+        else if (fast_sync_free_head != fast_sync_free_tail)
+            index = fast_sync_free[fast_sync_free_head++ % FAST_SYNC_SLOTS];
+    }
+    RtlLeaveCriticalSection( &fast_sync_section );
+
+    if (index != -1)
+    {
+        fast_sync_slots[index].value = value;
+        fast_sync_slots[index].waiters = 0;
+    }
+    return index;
+}
+
+/***********************************************************************
+ *           free_fast_sync_slot
+ *
+ * Free a slot once the server no longer references it.
+ */
+void free_fast_sync_slot( int index )
+{
+    RtlEnterCriticalSection( &fast_sync_section );
+    fast_sync_free[fast_sync_free_tail++ % FAST_SYNC_SLOTS] = index;
+    RtlLeaveCriticalSection( &fast_sync_section );
+}
+
+/***********************************************************************
+ *           add_fast_sync_handle
+ *
+ * Associate a new handle with its slot. If this fails the slot is lost,
+ * the server takes the object over the first time the handle is used.
+ */
+static void add_fast_sync_handle( HANDLE handle, int index, enum fast_sync_type type,
+                                  int max, BOOL manual_reset )
+{
+    unsigned int block, idx = fast_sync_handle_to_index( handle, &block );
+    struct fast_sync_entry *entry;
+
+    if (block >= FAST_SYNC_BLOCKS) return;
+
+    RtlEnterCriticalSection( &fast_sync_section );
+    if (!fast_sync_table[block])
+    {
+        void *ptr = NULL;
+        SIZE_T size = FAST_SYNC_BLOCK_SIZE * sizeof(struct fast_sync_entry);
+
+        if (!NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, 0, &size, MEM_COMMIT, PAGE_READWRITE ))
+            fast_sync_table[block] = ptr;
+    }
+    if (fast_sync_table[block])
+    {
+        entry = &fast_sync_table[block][idx];
+        entry->type = type;
+        entry->max = max;
+        entry->manual_reset = manual_reset;
+        interlocked_xchg( &entry->slot, index + 1 );
+    }
+    RtlLeaveCriticalSection( &fast_sync_section );
+}
+
+/***********************************************************************
+ *           remove_fast_sync_handle
+ *
+ * Remove a handle that is about to be closed, return its slot or -1.
+ */
+int remove_fast_sync_handle( HANDLE handle )
+{
+    unsigned int block, idx = fast_sync_handle_to_index( handle, &block );
+
+    if (block >= FAST_SYNC_BLOCKS || !fast_sync_table[block]) return -1;
+    return interlocked_xchg( &fast_sync_table[block][idx].slot, 0 ) - 1;
+}
+
+/* get the slot of a handle, if the client still manages its state */
+static struct fast_sync_slot *get_fast_sync( HANDLE handle, enum fast_sync_type type,
+                                             struct fast_sync_entry *info )
+{
+    unsigned int block, idx = fast_sync_handle_to_index( handle, &block );
+    struct fast_sync_slot *slot;
+
+    if (block >= FAST_SYNC_BLOCKS || !fast_sync_table[block]) return NULL;
+    *info = fast_sync_table[block][idx];
+    if (!info->slot || (type != FAST_SYNC_ANY && type != info->type)) return NULL;
+    slot = &fast_sync_slots[info->slot - 1];
+    if (slot->value == FAST_SYNC_SERVER) return NULL;
+    return slot;
+}
+
+/* add to the count of a fast object, fail with STATUS_NOT_IMPLEMENTED if the server owns it */
+static NTSTATUS fast_sync_release( HANDLE handle, ULONG count, ULONG *prev )
+{
+    struct fast_sync_entry info;
+    struct fast_sync_slot *slot;
+    int val, tmp;
+
+    if (!(slot = get_fast_sync( handle, FAST_SYNC_SEMAPHORE, &info ))) return STATUS_NOT_IMPLEMENTED;
+
+    for (val = slot->value;; val = tmp)
+    {
+        if (val == FAST_SYNC_SERVER) return STATUS_NOT_IMPLEMENTED;
+        if (prev) *prev = val;
+        if (count > info.max - val) return STATUS_SEMAPHORE_LIMIT_EXCEEDED;
+        if ((tmp = interlocked_cmpxchg( &slot->value, val + count, val )) == val) break;
+    }
+    if (slot->waiters) fast_sync_futex_wake( &slot->value, count );
+    return STATUS_SUCCESS;
+}
+
+/* set the state of a fast event, fail with STATUS_NOT_IMPLEMENTED if the server owns it */
+static NTSTATUS fast_sync_set_event( HANDLE handle, int state )
+{
+    struct fast_sync_entry info;
+    struct fast_sync_slot *slot;
+    int val, tmp;
+
+    if (!(slot = get_fast_sync( handle, FAST_SYNC_EVENT, &info ))) return STATUS_NOT_IMPLEMENTED;
+
+    for (val = slot->value;; val = tmp)
+    {
+        if (val == FAST_SYNC_SERVER) return STATUS_NOT_IMPLEMENTED;
+        if (val == state) return STATUS_SUCCESS;
+        if ((tmp = interlocked_cmpxchg( &slot->value, state, val )) == val) break;
+    }
+    if (state && slot->waiters) fast_sync_futex_wake( &slot->value, info.manual_reset ? INT_MAX : 1 );
+    return STATUS_SUCCESS;
+}
+
+/* query the state of a fast object, fail with STATUS_NOT_IMPLEMENTED if the server owns it */
+static NTSTATUS fast_sync_query( HANDLE handle, enum fast_sync_type type, int *value,
+                                 struct fast_sync_entry *info )
+{
+    struct fast_sync_slot *slot;
+
+    if (!(slot = get_fast_sync( handle, type, info ))) return STATUS_NOT_IMPLEMENTED;
+    if ((*value = slot->value) == FAST_SYNC_SERVER) return STATUS_NOT_IMPLEMENTED;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           fast_sync_wait
+ *
+ * Wait on a single fast object; fail with STATUS_NOT_IMPLEMENTED if the
+ * server owns it, in which case a relative timeout has been replaced by
+ * the corresponding absolute one stored in end.
+ */
+static NTSTATUS fast_sync_wait( HANDLE handle, const LARGE_INTEGER **timeout, LARGE_INTEGER *end )
+{
+    struct fast_sync_entry info;
+    struct fast_sync_slot *slot;
+    struct timespec timespec;
+    LARGE_INTEGER now;
+    LONGLONG diff;
+    int val;
+
+    if (!(slot = get_fast_sync( handle, FAST_SYNC_ANY, &info ))) return STATUS_NOT_IMPLEMENTED;
+
+    if (*timeout && (*timeout)->QuadPart < 0)
+    {
+        NtQuerySystemTime( &now );
+        end->QuadPart = now.QuadPart - (*timeout)->QuadPart;
+        *timeout = end;
+    }
+
+    for (;;)
+    {
+        if ((val = slot->value) == FAST_SYNC_SERVER) return STATUS_NOT_IMPLEMENTED;
+        if (val > 0)
+        {
+            if (info.manual_reset) return STATUS_WAIT_0;
+            if (interlocked_cmpxchg( &slot->value, val - 1, val ) == val) return STATUS_WAIT_0;
+            continue;
+        }
+
+        interlocked_xchg_add( &slot->waiters, 1 );
+        if (*timeout && (*timeout)->QuadPart != TIMEOUT_INFINITE)
+        {
+            NtQuerySystemTime( &now );
+            if ((diff = (*timeout)->QuadPart - now.QuadPart) <= 0)
+            {
+                interlocked_xchg_add( &slot->waiters, -1 );
+                return STATUS_TIMEOUT;
+            }
+            timespec.tv_sec  = diff / 10000000;
+            timespec.tv_nsec = (diff % 10000000) * 100;
+            fast_sync_futex_wait( &slot->value, 0, &timespec );
+        }
+        else fast_sync_futex_wait( &slot->value, 0, NULL );
+        interlocked_xchg_add( &slot->waiters, -1 );
+    }
+}
+
 /*
  *	Semaphores
  */
@@ -161,6 +512,7 @@ NTSTATUS WINAPI NtCreateSemaphore( OUT PHANDLE SemaphoreHandle,
     NTSTATUS ret;
     struct object_attributes objattr;
     struct security_descriptor *sd = NULL;
+    int fast_slot, fast = 0;
 
     if (MaximumCount <= 0 || InitialCount < 0 || InitialCount > MaximumCount)
         return STATUS_INVALID_PARAMETER;
@@ -175,20 +527,27 @@ NTSTATUS WINAPI NtCreateSemaphore( OUT PHANDLE SemaphoreHandle,
         if (ret != STATUS_SUCCESS) return ret;
     }
 
+    fast_slot = alloc_fast_sync_slot( attr, access, SEMAPHORE_ALL_ACCESS, InitialCount );
+
     SERVER_START_REQ( create_semaphore )
     {
         req->access  = access;
         req->attributes = (attr) ? attr->Attributes : 0;
         req->initial = InitialCount;
         req->max     = MaximumCount;
+        req->fast_slot = fast_slot;
         wine_server_add_data( req, &objattr, sizeof(objattr) );
         if (objattr.sd_len) wine_server_add_data( req, sd, objattr.sd_len );
         if (len) wine_server_add_data( req, attr->ObjectName->Buffer, len );
         ret = wine_server_call( req );
         *SemaphoreHandle = wine_server_ptr_handle( reply->handle );
+        fast = reply->fast;
     }
     SERVER_END_REQ;
 
+    if (fast) add_fast_sync_handle( *SemaphoreHandle, fast_slot, FAST_SYNC_SEMAPHORE, MaximumCount, FALSE );
+    else if (fast_slot != -1) free_fast_sync_slot( fast_slot );
+
     NTDLL_free_struct_sd( sd );
 
     return ret;
@@ -227,6 +586,8 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
 {
     NTSTATUS ret;
     SEMAPHORE_BASIC_INFORMATION *out = info;
+    struct fast_sync_entry fast;
+    int count;
 
     if (class != SemaphoreBasicInformation)
     {
@@ -236,6 +597,14 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
 
     if (len != sizeof(SEMAPHORE_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if (!fast_sync_query( handle, FAST_SYNC_SEMAPHORE, &count, &fast ))
+    {
+        out->CurrentCount = count;
+        out->MaximumCount = fast.max;
+        if (ret_len) *ret_len = sizeof(SEMAPHORE_BASIC_INFORMATION);
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( query_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -257,6 +626,9 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
 NTSTATUS WINAPI NtReleaseSemaphore( HANDLE handle, ULONG count, PULONG previous )
 {
     NTSTATUS ret;
+
+    if ((ret = fast_sync_release( handle, count, previous )) != STATUS_NOT_IMPLEMENTED) return ret;
+
     SERVER_START_REQ( release_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -285,6 +657,7 @@ NTSTATUS WINAPI NtCreateEvent( PHANDLE EventHandle, ACCESS_MASK DesiredAccess,
     NTSTATUS ret;
     struct security_descriptor *sd = NULL;
     struct object_attributes objattr;
+    int fast_slot, fast = 0;
 
     if (len >= MAX_PATH * sizeof(WCHAR)) return STATUS_NAME_TOO_LONG;
 
@@ -297,20 +670,27 @@ NTSTATUS WINAPI NtCreateEvent( PHANDLE EventHandle, ACCESS_MASK DesiredAccess,
         if (ret != STATUS_SUCCESS) return ret;
     }
 
+    fast_slot = alloc_fast_sync_slot( attr, DesiredAccess, EVENT_ALL_ACCESS, InitialState != 0 );
+
     SERVER_START_REQ( create_event )
     {
         req->access = DesiredAccess;
         req->attributes = (attr) ? attr->Attributes : 0;
         req->manual_reset = (type == NotificationEvent);
         req->initial_state = InitialState;
+        req->fast_slot = fast_slot;
         wine_server_add_data( req, &objattr, sizeof(objattr) );
         if (objattr.sd_len) wine_server_add_data( req, sd, objattr.sd_len );
         if (len) wine_server_add_data( req, attr->ObjectName->Buffer, len );
         ret = wine_server_call( req );
         *EventHandle = wine_server_ptr_handle( reply->handle );
+        fast = reply->fast;
     }
     SERVER_END_REQ;
 
+    if (fast) add_fast_sync_handle( *EventHandle, fast_slot, FAST_SYNC_EVENT, 1, type == NotificationEvent );
+    else if (fast_slot != -1) free_fast_sync_slot( fast_slot );
+
     NTDLL_free_struct_sd( sd );
 
     return ret;
@@ -354,6 +734,8 @@ NTSTATUS WINAPI NtSetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
 
     /* FIXME: set NumberOfThreadsReleased */
 
+    if (!fast_sync_set_event( handle, 1 )) return STATUS_SUCCESS;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -374,6 +756,8 @@ NTSTATUS WINAPI NtResetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
     /* resetting an event can't release any thread... */
     if (NumberOfThreadsReleased) *NumberOfThreadsReleased = 0;
 
+    if (!fast_sync_set_event( handle, 0 )) return STATUS_SUCCESS;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -426,6 +810,8 @@ NTSTATUS WINAPI NtQueryEvent( HANDLE handle, EVENT_INFORMATION_CLASS class,
 {
     NTSTATUS ret;
     EVENT_BASIC_INFORMATION *out = info;
+    struct fast_sync_entry fast;
+    int state;
 
     if (class != EventBasicInformation)
     {
@@ -436,6 +822,14 @@ NTSTATUS WINAPI NtQueryEvent( HANDLE handle, EVENT_INFORMATION_CLASS class,
 
     if (len != sizeof(EVENT_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if (!fast_sync_query( handle, FAST_SYNC_EVENT, &state, &fast ))
+    {
+        out->EventType  = fast.manual_reset ? NotificationEvent : SynchronizationEvent;
+        out->EventState = state;
+        if (ret_len) *ret_len = sizeof(EVENT_BASIC_INFORMATION);
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( query_event )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -854,9 +1248,16 @@ NTSTATUS WINAPI NtWaitForMultipleObjects( DWORD count, const HANDLE *handles,
 {
     select_op_t select_op;
     UINT i, flags = SELECT_INTERRUPTIBLE;
+    LARGE_INTEGER end;
+    NTSTATUS ret;
 
     if (!count || count > MAXIMUM_WAIT_OBJECTS) return STATUS_INVALID_PARAMETER_1;
 
+    /* alertable waits need the server to deliver the user APCs */
+    if (count == 1 && !alertable &&
+        (ret = fast_sync_wait( handles[0], &timeout, &end )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     if (alertable) flags |= SELECT_ALERTABLE;
     select_op.wait.op = wait_any ? SELECT_WAIT : SELECT_WAIT_ALL;
     for (i = 0; i < count; i++) select_op.wait.handles[i] = wine_server_obj_handle( handles[i] );
@@ -1164,6 +1565,60 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE CompletionPort, PULONG_PTR Completi
     return status;
 }
 
+/******************************************************************
+ *              NtRemoveIoCompletionEx (NTDLL.@)
+ *              ZwRemoveIoCompletionEx (NTDLL.@)
+ *
+ * (Wait for and) retrieve multiple completion messages from completion object's queue
+ *
+ * PARAMS
+ *      port     [I] HANDLE to I/O completion object
+ *      info     [O] array of completion messages
+ *      count    [I] size of the info array
+ *      written  [O] number of messages retrieved
+ *      timeout  [I] optional wait time in NTDLL format
+ *      alertable[I] whether the wait is alertable
+ *
+ */
+NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE port, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
+                                        ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
+{
+    completion_msg_t msgs[64];
+    NTSTATUS status;
+    ULONG i, ret = 0;
+
+    TRACE("(%p, %p, %u, %p, %p, %u)\n", port, info, count, written, timeout, alertable);
+
+    if (!count) return STATUS_INVALID_PARAMETER;
+
+    for (;;)
+    {
+        SERVER_START_REQ( remove_completions )
+        {
+            req->handle = wine_server_obj_handle( port );
+            wine_server_set_reply( req, msgs, min( count, sizeof(msgs)/sizeof(msgs[0]) ) * sizeof(msgs[0]) );
+            if (!(status = wine_server_call( req )))
+            {
+                ret = wine_server_reply_size( reply ) / sizeof(msgs[0]);
+                for (i = 0; i < ret; i++)
+                {
+                    info[i].CompletionKey             = msgs[i].ckey;
+                    info[i].CompletionValue           = msgs[i].cvalue;
+                    info[i].IoStatusBlock.Information = msgs[i].information;
+                    info[i].IoStatusBlock.u.Status    = msgs[i].status;
+                }
+            }
+        }
+        SERVER_END_REQ;
+        if (status != STATUS_PENDING) break;
+
+        status = NtWaitForSingleObject( port, alertable, timeout );
+        if (status != WAIT_OBJECT_0) break;
+    }
+    *written = ret ? ret : 1;
+    return status;
+}
+
 /******************************************************************
  *              NtOpenIoCompletion (NTDLL.@)
  *              ZwOpenIoCompletion (NTDLL.@)
@@ -1504,6 +1959,297 @@ static inline void srwlock_leave_shared( RTL_SRWLOCK *lock, unsigned int val )
         NtReleaseKeyedEvent( keyed_event, srwlock_key_exclusive(lock), FALSE, NULL );
 }
 
+#ifdef __linux__
+
+/* Futex-based SRW lock and condition variable implementation
+ *
+ * When futexes are available, waiting threads are parked in the kernel
+ * instead of going through the keyed event, so that neither waiting nor
+ * waking requires a server round trip. The SRW lock then uses a
+ * different memory layout:
+ *
+ * 32 31            16               0
+ *  ________________ ________________
+ * | X| #exclusive  | S|   #shared   |
+ *  ¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯¯
+ * X is set while the lock is owned exclusively, #exclusive counts the
+ * threads waiting for exclusive access, S is set while threads are waiting
+ * for shared access and #shared counts the current shared owners. Shared access is not granted while exclusive waiters are queued,
+ * so that exclusive threads are preferred like in the keyed event version.
+ * Exclusive and shared waiters sleep on the same futex but with different
+ * bitsets, so that each group can be woken separately.
+ *
+ * Condition variables use their value as a sequence number that is
+ * incremented on every wake; sleepers wait for it to change.
+ */
+
+#define SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT      0x80000000
+#define SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK  0x7fff0000
+#define SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_INC   0x00010000
+#define SRWLOCK_FUTEX_SHARED_WAITERS_BIT      0x00008000
+#define SRWLOCK_FUTEX_SHARED_OWNERS_MASK      0x00007fff
+#define SRWLOCK_FUTEX_SHARED_OWNERS_INC       0x00000001
+
+#define SRWLOCK_FUTEX_BITSET_EXCLUSIVE  1
+#define SRWLOCK_FUTEX_BITSET_SHARED     2
+
+static int futex_private = 128; /*FUTEX_PRIVATE_FLAG*/
+
+static inline int futex_wait( int *addr, int val, struct timespec *timeout )
+{
+    return syscall( __NR_futex, addr, 0 /*FUTEX_WAIT*/ | futex_private, val, timeout, 0, 0 );
+}
+
+static inline int futex_wake( int *addr, int val )
+{
+    return syscall( __NR_futex, addr, 1 /*FUTEX_WAKE*/ | futex_private, val, NULL, 0, 0 );
+}
+
+static inline int futex_wait_bitset( int *addr, int val, int mask )
+{
+    return syscall( __NR_futex, addr, 9 /*FUTEX_WAIT_BITSET*/ | futex_private, val, NULL, 0, mask );
+}
+
+static inline int futex_wake_bitset( int *addr, int val, int mask )
+{
+    return syscall( __NR_futex, addr, 10 /*FUTEX_WAKE_BITSET*/ | futex_private, val, NULL, 0, mask );
+}
+
+static inline int use_futexes(void)
+{
+    static int supported = -1;
+
+    if (supported == -1)
+    {
+        futex_wait_bitset( &supported, 10, ~0 );
+        if (errno == ENOSYS)
+        {
+            futex_private = 0;
+            futex_wait_bitset( &supported, 10, ~0 );
+        }
+        supported = (errno != ENOSYS);
+    }
+    return supported;
+}
+
+static NTSTATUS fast_try_acquire_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    int *futex = (int *)&lock->Ptr;
+    unsigned int val;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    for (;;)
+    {
+        val = *futex;
+        if (val & (SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT | SRWLOCK_FUTEX_SHARED_OWNERS_MASK))
+            return STATUS_TIMEOUT;
+        if (interlocked_cmpxchg( futex, val | SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT, val ) == val)
+            return STATUS_SUCCESS;
+    }
+}
+
+static NTSTATUS fast_acquire_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    int *futex = (int *)&lock->Ptr;
+    unsigned int val, tmp;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    /* register as an exclusive waiter first, this keeps new shared owners out */
+    for (val = *futex;; val = tmp)
+    {
+        tmp = val + SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_INC;
+        if (!(tmp & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK)) RtlRaiseStatus( STATUS_RESOURCE_NOT_OWNED );
+        if ((tmp = interlocked_cmpxchg( futex, tmp, val )) == val) break;
+    }
+
+    for (;;)
+    {
+        val = *futex;
+        if (!(val & (SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT | SRWLOCK_FUTEX_SHARED_OWNERS_MASK)))
+        {
+            tmp = (val | SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT) - SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_INC;
+            if (interlocked_cmpxchg( futex, tmp, val ) == val) return STATUS_SUCCESS;
+            continue;
+        }
+        futex_wait_bitset( futex, val, SRWLOCK_FUTEX_BITSET_EXCLUSIVE );
+    }
+}
+
+static NTSTATUS fast_try_acquire_srw_shared( RTL_SRWLOCK *lock )
+{
+    int *futex = (int *)&lock->Ptr;
+    unsigned int val, tmp;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    for (;;)
+    {
+        val = *futex;
+        if (val & (SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT | SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK))
+            return STATUS_TIMEOUT;
+        if ((val & SRWLOCK_FUTEX_SHARED_OWNERS_MASK) == SRWLOCK_FUTEX_SHARED_OWNERS_MASK)
+            RtlRaiseStatus( STATUS_RESOURCE_NOT_OWNED );
+        tmp = val + SRWLOCK_FUTEX_SHARED_OWNERS_INC;
+        if (interlocked_cmpxchg( futex, tmp, val ) == val) return STATUS_SUCCESS;
+    }
+}
+
+static NTSTATUS fast_acquire_srw_shared( RTL_SRWLOCK *lock )
+{
+    int *futex = (int *)&lock->Ptr;
+    unsigned int val, tmp;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    for (;;)
+    {
+        val = *futex;
+        if (!(val & (SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT | SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK)))
+        {
+            if ((val & SRWLOCK_FUTEX_SHARED_OWNERS_MASK) == SRWLOCK_FUTEX_SHARED_OWNERS_MASK)
+                RtlRaiseStatus( STATUS_RESOURCE_NOT_OWNED );
+            tmp = val + SRWLOCK_FUTEX_SHARED_OWNERS_INC;
+            if (interlocked_cmpxchg( futex, tmp, val ) == val) return STATUS_SUCCESS;
+            continue;
+        }
+        /* flag the shared waiters so that the exclusive owner knows it has to wake us */
+        tmp = val | SRWLOCK_FUTEX_SHARED_WAITERS_BIT;
+        if (tmp != val && interlocked_cmpxchg( futex, tmp, val ) != val) continue;
+        futex_wait_bitset( futex, tmp, SRWLOCK_FUTEX_BITSET_SHARED );
+    }
+}
+
+static NTSTATUS fast_release_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    int *futex = (int *)&lock->Ptr;
+    unsigned int val, tmp;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    for (val = *futex;; val = tmp)
+    {
+        if (!(val & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT)) RtlRaiseStatus( STATUS_RESOURCE_NOT_OWNED );
+        tmp = val & ~SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT;
+        if (!(tmp & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK)) tmp &= ~SRWLOCK_FUTEX_SHARED_WAITERS_BIT;
+        if ((tmp = interlocked_cmpxchg( futex, tmp, val )) == val) break;
+    }
+
+    /* exclusive waiters are processed first, followed by the shared waiters */
+    if (val & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK)
+        futex_wake_bitset( futex, 1, SRWLOCK_FUTEX_BITSET_EXCLUSIVE );
+    else if (val & SRWLOCK_FUTEX_SHARED_WAITERS_BIT)
+        futex_wake_bitset( futex, INT_MAX, SRWLOCK_FUTEX_BITSET_SHARED );
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_release_srw_shared( RTL_SRWLOCK *lock )
+{
+    int *futex = (int *)&lock->Ptr;
+    unsigned int val, tmp;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    for (val = *futex;; val = tmp)
+    {
+        if (val & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT) RtlRaiseStatus( STATUS_RESOURCE_NOT_OWNED );
+        if (!(val & SRWLOCK_FUTEX_SHARED_OWNERS_MASK)) RtlRaiseStatus( STATUS_RESOURCE_NOT_OWNED );
+        tmp = val - SRWLOCK_FUTEX_SHARED_OWNERS_INC;
+        if ((tmp = interlocked_cmpxchg( futex, tmp, val )) == val) break;
+    }
+
+    /* wake up one exclusive thread as soon as the last shared owner has left */
+    val -= SRWLOCK_FUTEX_SHARED_OWNERS_INC;
+    if (!(val & SRWLOCK_FUTEX_SHARED_OWNERS_MASK) && (val & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK))
+        futex_wake_bitset( futex, 1, SRWLOCK_FUTEX_BITSET_EXCLUSIVE );
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_wait_cv( RTL_CONDITION_VARIABLE *variable, int val, const LARGE_INTEGER *timeout )
+{
+    struct timespec timespec;
+    LARGE_INTEGER now;
+    LONGLONG diff;
+    int ret;
+
+    if (timeout && timeout->QuadPart != TIMEOUT_INFINITE)
+    {
+        if ((diff = timeout->QuadPart) >= 0)
+        {
+            NtQuerySystemTime( &now );
+            diff -= now.QuadPart;
+            if (diff < 0) diff = 0;
+        }
+        else diff = -diff;
+        timespec.tv_sec  = diff / 10000000;
+        timespec.tv_nsec = (diff % 10000000) * 100;
+        ret = futex_wait( (int *)&variable->Ptr, val, &timespec );
+    }
+    else ret = futex_wait( (int *)&variable->Ptr, val, NULL );
+
+    if (ret == -1 && errno == ETIMEDOUT) return STATUS_TIMEOUT;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_wake_cv( RTL_CONDITION_VARIABLE *variable, int count )
+{
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    interlocked_xchg_add( (int *)&variable->Ptr, 1 );
+    futex_wake( (int *)&variable->Ptr, count );
+    return STATUS_SUCCESS;
+}
+
+#else
+
+static inline int use_futexes(void)
+{
+    return 0;
+}
+
+static inline NTSTATUS fast_try_acquire_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_acquire_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_try_acquire_srw_shared( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_acquire_srw_shared( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_release_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_release_srw_shared( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_wait_cv( RTL_CONDITION_VARIABLE *variable, int val, const LARGE_INTEGER *timeout )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static inline NTSTATUS fast_wake_cv( RTL_CONDITION_VARIABLE *variable, int count )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+#endif
+
 /***********************************************************************
  *              RtlInitializeSRWLock (NTDLL.@)
  *
@@ -1512,7 +2258,8 @@ static inline void srwlock_leave_shared( RTL_SRWLOCK *lock, unsigned int val )
  *  It doesn't make any difference which thread for example unlocks an
  *  SRWLock (see corresponding tests). This implementation uses two
  *  keyed events (one for the exclusive waiters and one for the shared
- *  waiters) and is limited to 2^15-1 waiting threads.
+ *  waiters) and is limited to 2^15-1 waiting threads. When futexes are
+ *  available, waiting threads are parked directly in the kernel instead.
  */
 void WINAPI RtlInitializeSRWLock( RTL_SRWLOCK *lock )
 {
@@ -1529,6 +2276,9 @@ void WINAPI RtlInitializeSRWLock( RTL_SRWLOCK *lock )
  */
 void WINAPI RtlAcquireSRWLockExclusive( RTL_SRWLOCK *lock )
 {
+    if (fast_acquire_srw_exclusive( lock ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
     if (srwlock_lock_exclusive( (unsigned int *)&lock->Ptr, SRWLOCK_RES_EXCLUSIVE ))
         NtWaitForKeyedEvent( keyed_event, srwlock_key_exclusive(lock), FALSE, NULL );
 }
@@ -1543,6 +2293,10 @@ void WINAPI RtlAcquireSRWLockExclusive( RTL_SRWLOCK *lock )
 void WINAPI RtlAcquireSRWLockShared( RTL_SRWLOCK *lock )
 {
     unsigned int val, tmp;
+
+    if (fast_acquire_srw_shared( lock ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
     /* Acquires a shared lock. If it's currently not possible to add elements to
      * the shared queue, then request exclusive access instead. */
     for (val = *(unsigned int *)&lock->Ptr;; val = tmp)
@@ -1573,6 +2327,9 @@ void WINAPI RtlAcquireSRWLockShared( RTL_SRWLOCK *lock )
  */
 void WINAPI RtlReleaseSRWLockExclusive( RTL_SRWLOCK *lock )
 {
+    if (fast_release_srw_exclusive( lock ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
     srwlock_leave_exclusive( lock, srwlock_unlock_exclusive( (unsigned int *)&lock->Ptr,
                              - SRWLOCK_RES_EXCLUSIVE ) - SRWLOCK_RES_EXCLUSIVE );
 }
@@ -1582,6 +2339,9 @@ void WINAPI RtlReleaseSRWLockExclusive( RTL_SRWLOCK *lock )
  */
 void WINAPI RtlReleaseSRWLockShared( RTL_SRWLOCK *lock )
 {
+    if (fast_release_srw_shared( lock ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
     srwlock_leave_shared( lock, srwlock_lock_exclusive( (unsigned int *)&lock->Ptr,
                           - SRWLOCK_RES_SHARED ) - SRWLOCK_RES_SHARED );
 }
@@ -1595,6 +2355,11 @@ void WINAPI RtlReleaseSRWLockShared( RTL_SRWLOCK *lock )
  */
 BOOLEAN WINAPI RtlTryAcquireSRWLockExclusive( RTL_SRWLOCK *lock )
 {
+    NTSTATUS ret;
+
+    if ((ret = fast_try_acquire_srw_exclusive( lock )) != STATUS_NOT_IMPLEMENTED)
+        return (ret == STATUS_SUCCESS);
+
     return interlocked_cmpxchg( (int *)&lock->Ptr, SRWLOCK_MASK_IN_EXCLUSIVE |
                                 SRWLOCK_RES_EXCLUSIVE, 0 ) == 0;
 }
@@ -1605,6 +2370,11 @@ BOOLEAN WINAPI RtlTryAcquireSRWLockExclusive( RTL_SRWLOCK *lock )
 BOOLEAN WINAPI RtlTryAcquireSRWLockShared( RTL_SRWLOCK *lock )
 {
     unsigned int val, tmp;
+    NTSTATUS ret;
+
+    if ((ret = fast_try_acquire_srw_shared( lock )) != STATUS_NOT_IMPLEMENTED)
+        return (ret == STATUS_SUCCESS);
+
     for (val = *(unsigned int *)&lock->Ptr;; val = tmp)
     {
         if (val & SRWLOCK_MASK_EXCLUSIVE_QUEUE)
@@ -1648,6 +2418,9 @@ void WINAPI RtlInitializeConditionVariable( RTL_CONDITION_VARIABLE *variable )
  */
 void WINAPI RtlWakeConditionVariable( RTL_CONDITION_VARIABLE *variable )
 {
+    if (fast_wake_cv( variable, 1 ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
     if (interlocked_dec_if_nonzero( (int *)&variable->Ptr ))
         NtReleaseKeyedEvent( keyed_event, &variable->Ptr, FALSE, NULL );
 }
@@ -1659,7 +2432,12 @@ void WINAPI RtlWakeConditionVariable( RTL_CONDITION_VARIABLE *variable )
  */
 void WINAPI RtlWakeAllConditionVariable( RTL_CONDITION_VARIABLE *variable )
 {
-    int val = interlocked_xchg( (int *)&variable->Ptr, 0 );
+    int val;
+
+    if (fast_wake_cv( variable, INT_MAX ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
+    val = interlocked_xchg( (int *)&variable->Ptr, 0 );
     while (val-- > 0)
         NtReleaseKeyedEvent( keyed_event, &variable->Ptr, FALSE, NULL );
 }
@@ -1683,6 +2461,17 @@ NTSTATUS WINAPI RtlSleepConditionVariableCS( RTL_CONDITION_VARIABLE *variable, R
                                              const LARGE_INTEGER *timeout )
 {
     NTSTATUS status;
+
+    if (use_futexes())
+    {
+        int val = *(int *)&variable->Ptr;
+
+        RtlLeaveCriticalSection( crit );
+        status = fast_wait_cv( variable, val, timeout );
+        RtlEnterCriticalSection( crit );
+        return status;
+    }
+
     interlocked_xchg_add( (int *)&variable->Ptr, 1 );
     RtlLeaveCriticalSection( crit );
 
@@ -1720,18 +2509,33 @@ NTSTATUS WINAPI RtlSleepConditionVariableSRW( RTL_CONDITION_VARIABLE *variable,
                                               const LARGE_INTEGER *timeout, ULONG flags )
 {
     NTSTATUS status;
-    interlocked_xchg_add( (int *)&variable->Ptr, 1 );
 
-    if (flags & RTL_CONDITION_VARIABLE_LOCKMODE_SHARED)
-        RtlReleaseSRWLockShared( lock );
-    else
-        RtlReleaseSRWLockExclusive( lock );
+    if (use_futexes())
+    {
+        int val = *(int *)&variable->Ptr;
 
-    status = NtWaitForKeyedEvent( keyed_event, &variable->Ptr, FALSE, timeout );
-    if (status != STATUS_SUCCESS)
+        if (flags & RTL_CONDITION_VARIABLE_LOCKMODE_SHARED)
+            RtlReleaseSRWLockShared( lock );
+        else
+            RtlReleaseSRWLockExclusive( lock );
+
+        status = fast_wait_cv( variable, val, timeout );
+    }
+    else
     {
-        if (!interlocked_dec_if_nonzero( (int *)&variable->Ptr ))
-            status = NtWaitForKeyedEvent( keyed_event, &variable->Ptr, FALSE, NULL );
+        interlocked_xchg_add( (int *)&variable->Ptr, 1 );
+
+        if (flags & RTL_CONDITION_VARIABLE_LOCKMODE_SHARED)
+            RtlReleaseSRWLockShared( lock );
+        else
+            RtlReleaseSRWLockExclusive( lock );
+
+        status = NtWaitForKeyedEvent( keyed_event, &variable->Ptr, FALSE, timeout );
+        if (status != STATUS_SUCCESS)
+        {
+            if (!interlocked_dec_if_nonzero( (int *)&variable->Ptr ))
+                status = NtWaitForKeyedEvent( keyed_event, &variable->Ptr, FALSE, NULL );
+        }
     }
 
     if (flags & RTL_CONDITION_VARIABLE_LOCKMODE_SHARED)
@@ -38,6 +38,15 @@
 #ifdef HAVE_SYS_MMAN_H
 # include <sys/mman.h>
 #endif
+#ifdef HAVE_SYS_IOCTL_H
+# include <sys/ioctl.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
+#ifdef HAVE_LINUX_USERFAULTFD_H
+# include <linux/userfaultfd.h>
+#endif
 #ifdef HAVE_VALGRIND_VALGRIND_H
 # include <valgrind/valgrind.h>
 #endif
@@ -52,6 +61,7 @@
 #include "wine/server.h"
 #include "wine/exception.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 #include "wine/debug.h"
 #include "ntdll_misc.h"
 
@@ -66,6 +76,7 @@ WINE_DECLARE_DEBUG_CHANNEL(module);
 struct file_view
 {
     struct list   entry;       /* Entry in global view list */
+    struct wine_rb_entry tree_entry; /* Entry in global view tree */
     void         *base;        /* Base address */
     size_t        size;        /* Size in bytes */
     HANDLE        mapping;     /* Handle to the file mapping */
@@ -98,6 +109,44 @@ static const BYTE VIRTUAL_Win32Flags[16] =
 
 static struct list views_list = LIST_INIT(views_list);
 
+/* the rbtree only needs a stack as deep as the tree, which is bounded
+ * by the address space size, so use a static one; views are created
+ * before any heap is available */
+static struct wine_rb_entry **views_tree_stack[2 * 8 * sizeof(void *)];
+
+static void *views_tree_alloc( size_t size )
+{
+    return size <= sizeof(views_tree_stack) ? views_tree_stack : NULL;
+}
+
+static void *views_tree_realloc( void *ptr, size_t size )
+{
+    return views_tree_alloc( size );
+}
+
+static void views_tree_free( void *ptr )
+{
+}
+
+static int compare_view( const void *addr, const struct wine_rb_entry *entry )
+{
+    const struct file_view *view = WINE_RB_ENTRY_VALUE( entry, const struct file_view, tree_entry );
+
+    if (addr < view->base) return -1;
+    if (addr > view->base) return 1;
+    return 0;
+}
+
+static const struct wine_rb_functions views_tree_functions =
+{
+    views_tree_alloc,
+    views_tree_realloc,
+    views_tree_free,
+    compare_view
+};
+
+static struct wine_rb_tree views_tree;
+
 static RTL_CRITICAL_SECTION csVirtual;
 static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
 {
@@ -149,6 +198,7 @@ static void *preload_reserve_start;
 static void *preload_reserve_end;
 static BOOL use_locks;
 static BOOL force_exec_prot;  /* whether to force PROT_EXEC on all PROT_READ mmaps */
+static BOOL use_kernel_writewatch;  /* whether write watches are tracked by the kernel */
 
 
 /***********************************************************************
@@ -181,7 +231,7 @@ static int VIRTUAL_GetUnixProt( BYTE vprot )
         if (vprot & VPROT_WRITE) prot |= PROT_WRITE | PROT_READ;
         if (vprot & VPROT_WRITECOPY) prot |= PROT_WRITE | PROT_READ;
         if (vprot & VPROT_EXEC) prot |= PROT_EXEC | PROT_READ;
-        if (vprot & VPROT_WRITEWATCH) prot &= ~PROT_WRITE;
+        if ((vprot & VPROT_WRITEWATCH) && !use_kernel_writewatch) prot &= ~PROT_WRITE;
     }
     if (!prot) prot = PROT_NONE;
     return prot;
@@ -242,6 +292,31 @@ static void VIRTUAL_Dump(void)
 #endif
 
 
+/***********************************************************************
+ *           find_view_below
+ *
+ * Find the last view starting at or below a given address.
+ * The csVirtual section must be held by caller.
+ */
+static struct file_view *find_view_below( const void *addr )
+{
+    struct wine_rb_entry *ptr = views_tree.root;
+    struct file_view *view, *ret = NULL;
+
+    while (ptr)
+    {
+        view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, tree_entry );
+        if (view->base > addr) ptr = ptr->left;
+        else
+        {
+            ret = view;
+            ptr = ptr->right;
+        }
+    }
+    return ret;
+}
+
+
 /***********************************************************************
  *           VIRTUAL_FindView
  *
@@ -256,17 +331,13 @@ static void VIRTUAL_Dump(void)
  */
 static struct file_view *VIRTUAL_FindView( const void *addr, size_t size )
 {
-    struct file_view *view;
+    struct file_view *view = find_view_below( addr );
 
-    LIST_FOR_EACH_ENTRY( view, &views_list, struct file_view, entry )
-    {
-        if (view->base > addr) break;  /* no matching view */
-        if ((const char *)view->base + view->size <= (const char *)addr) continue;
-        if ((const char *)view->base + view->size < (const char *)addr + size) break;  /* size too large */
-        if ((const char *)addr + size < (const char *)addr) break; /* overflow */
-        return view;
-    }
-    return NULL;
+    if (!view) return NULL;  /* no matching view */
+    if ((const char *)view->base + view->size <= (const char *)addr) return NULL;
+    if ((const char *)view->base + view->size < (const char *)addr + size) return NULL;  /* size too large */
+    if ((const char *)addr + size < (const char *)addr) return NULL; /* overflow */
+    return view;
 }
 
 
@@ -289,14 +360,20 @@ static inline UINT_PTR get_mask( ULONG zero_bits )
  */
 static struct file_view *find_view_range( const void *addr, size_t size )
 {
-    struct file_view *view;
+    struct file_view *view = find_view_below( addr );
+    struct list *ptr;
 
-    LIST_FOR_EACH_ENTRY( view, &views_list, struct file_view, entry )
+    if (view)
     {
-        if ((const char *)view->base >= (const char *)addr + size) break;
         if ((const char *)view->base + view->size > (const char *)addr) return view;
+        ptr = list_next( &views_list, &view->entry );
     }
-    return NULL;
+    else ptr = list_head( &views_list );
+
+    if (!ptr) return NULL;
+    view = LIST_ENTRY( ptr, struct file_view, entry );
+    if ((const char *)view->base >= (const char *)addr + size) return NULL;
+    return view;
 }
 
 
@@ -308,6 +385,7 @@ static struct file_view *find_view_range( const void *addr, size_t size )
  */
 static void *find_free_area( void *base, void *end, size_t size, size_t mask, int top_down )
 {
+    struct file_view *first;
     struct list *ptr;
     void *start;
 
@@ -316,7 +394,10 @@ static void *find_free_area( void *base, void *end, size_t size, size_t mask, in
         start = ROUND_ADDR( (char *)end - size, mask );
         if (start >= end || start < base) return NULL;
 
-        for (ptr = views_list.prev; ptr != &views_list; ptr = ptr->prev)
+        /* skip the views above the range */
+        if (!(first = find_view_below( (char *)start + size - 1 ))) return start;
+
+        for (ptr = &first->entry; ptr != &views_list; ptr = ptr->prev)
         {
             struct file_view *view = LIST_ENTRY( ptr, struct file_view, entry );
 
@@ -332,7 +413,11 @@ static void *find_free_area( void *base, void *end, size_t size, size_t mask, in
         start = ROUND_ADDR( (char *)base + mask, mask );
         if (start >= end || (char *)end - (char *)start < size) return NULL;
 
-        for (ptr = views_list.next; ptr != &views_list; ptr = ptr->next)
+        /* skip the views below the range */
+        if ((first = find_view_below( start ))) ptr = &first->entry;
+        else ptr = views_list.next;
+
+        for ( ; ptr != &views_list; ptr = ptr->next)
         {
             struct file_view *view = LIST_ENTRY( ptr, struct file_view, entry );
 
@@ -438,6 +523,7 @@ static void delete_view( struct file_view *view ) /* [in] View */
 {
     if (!(view->protect & VPROT_SYSTEM)) unmap_area( view->base, view->size );
     list_remove( &view->entry );
+    wine_rb_remove( &views_tree, view->base );
     if (view->mapping) close_handle( view->mapping );
     RtlFreeHeap( virtual_heap, 0, view );
 }
@@ -450,7 +536,7 @@ static void delete_view( struct file_view *view ) /* [in] View */
  */
 static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t size, unsigned int vprot )
 {
-    struct file_view *view;
+    struct file_view *view, *prev;
     struct list *ptr;
     int unix_prot = VIRTUAL_GetUnixProt( vprot );
 
@@ -474,12 +560,8 @@ static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t siz
 
     /* Insert it in the linked list */
 
-    LIST_FOR_EACH( ptr, &views_list )
-    {
-        struct file_view *next = LIST_ENTRY( ptr, struct file_view, entry );
-        if (next->base > base) break;
-    }
-    list_add_before( ptr, &view->entry );
+    if ((prev = find_view_below( base ))) list_add_after( &prev->entry, &view->entry );
+    else list_add_head( &views_list, &view->entry );
 
     /* Check for overlapping views. This can happen if the previous view
      * was a system view that got unmapped behind our back. In that case
@@ -510,6 +592,8 @@ static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t siz
         }
     }
 
+    wine_rb_put( &views_tree, view->base, &view->tree_entry );
+
     *view_ret = view;
     VIRTUAL_DEBUG_DUMP_VIEW( view );
 
@@ -664,6 +748,205 @@ done:
 }
 
 
+#if defined(__linux__) && defined(HAVE_LINUX_USERFAULTFD_H) && defined(__NR_userfaultfd) && defined(UFFDIO_WRITEPROTECT)
+
+/* Write watches can be tracked by the kernel through userfaultfd asynchronous
+ * write protection, without taking a page fault signal on the first write to
+ * each page. The pagemap scan interface then reports the written pages and
+ * protects them again atomically. These are only available in recent kernel
+ * headers, so the ABI is defined here if needed. */
+
+#ifndef UFFD_FEATURE_WP_UNPOPULATED
+#define UFFD_FEATURE_WP_UNPOPULATED (1 << 13)
+#endif
+#ifndef UFFD_FEATURE_WP_ASYNC
+#define UFFD_FEATURE_WP_ASYNC (1 << 15)
+#endif
+#ifndef UFFD_USER_MODE_ONLY
+#define UFFD_USER_MODE_ONLY 1
+#endif
+
+#ifndef PAGEMAP_SCAN
+struct page_region
+{
+    __u64 start;
+    __u64 end;
+    __u64 categories;
+};
+
+struct pm_scan_arg
+{
+    __u64 size;
+    __u64 flags;
+    __u64 start;
+    __u64 end;
+    __u64 walk_end;
+    __u64 vec;
+    __u64 vec_len;
+    __u64 max_pages;
+    __u64 category_inverted;
+    __u64 category_mask;
+    __u64 category_anyof_mask;
+    __u64 return_mask;
+};
+
+#define PAGEMAP_SCAN            _IOWR('f', 16, struct pm_scan_arg)
+#define PM_SCAN_WP_MATCHING     (1 << 0)
+#define PM_SCAN_CHECK_WPASYNC   (1 << 1)
+#define PAGE_IS_WRITTEN         (1 << 1)
+#endif
+
+static int uffd_fd = -1;
+static int pagemap_fd = -1;
+
+/***********************************************************************
+ *           kernel_writewatch_init
+ */
+static void kernel_writewatch_init(void)
+{
+    struct uffdio_api api;
+    struct pm_scan_arg arg;
+
+    if ((uffd_fd = syscall( __NR_userfaultfd, UFFD_USER_MODE_ONLY | O_CLOEXEC | O_NONBLOCK )) == -1)
+        goto failed;
+
+    memset( &api, 0, sizeof(api) );
+    api.api = UFFD_API;
+    api.features = UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED;
+    if (ioctl( uffd_fd, UFFDIO_API, &api ) ||
+        (api.features & (UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED)) !=
+        (UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED))
+        goto failed;
+
+    if ((pagemap_fd = open( "/proc/self/pagemap", O_RDONLY | O_CLOEXEC )) == -1) goto failed;
+
+    /* check that the scan ioctl is supported with an empty range */
+    memset( &arg, 0, sizeof(arg) );
+    arg.size = sizeof(arg);
+    if (ioctl( pagemap_fd, PAGEMAP_SCAN, &arg ) == -1) goto failed;
+
+    TRACE( "using kernel write watches\n" );
+    use_kernel_writewatch = TRUE;
+    return;
+
+failed:
+    if (uffd_fd != -1) close( uffd_fd );
+    if (pagemap_fd != -1) close( pagemap_fd );
+    uffd_fd = pagemap_fd = -1;
+}
+
+/***********************************************************************
+ *           kernel_writewatch_reset
+ *
+ * Write protect a range so that the next write to each page gets recorded.
+ */
+static NTSTATUS kernel_writewatch_reset( void *base, SIZE_T size )
+{
+    struct uffdio_writeprotect wp;
+
+    wp.range.start = (UINT_PTR)base;
+    wp.range.len = size;
+    wp.mode = UFFDIO_WRITEPROTECT_MODE_WP;
+    if (ioctl( uffd_fd, UFFDIO_WRITEPROTECT, &wp ))
+    {
+        ERR( "failed to reset write watches for %p-%p: %s\n", base, (char *)base + size, strerror(errno) );
+        return FILE_GetNtStatus();
+    }
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           kernel_writewatch_register
+ *
+ * Start tracking the writes in a range.
+ */
+static NTSTATUS kernel_writewatch_register( void *base, SIZE_T size )
+{
+    struct uffdio_register reg;
+
+    reg.range.start = (UINT_PTR)base;
+    reg.range.len = size;
+    reg.mode = UFFDIO_REGISTER_MODE_WP;
+    if (ioctl( uffd_fd, UFFDIO_REGISTER, &reg ))
+    {
+        ERR( "failed to register write watches for %p-%p: %s\n", base, (char *)base + size, strerror(errno) );
+        return FILE_GetNtStatus();
+    }
+    return kernel_writewatch_reset( base, size );
+}
+
+/***********************************************************************
+ *           kernel_writewatch_update
+ *
+ * Transfer the written pages state from the kernel to the view protection
+ * bits, optionally resetting the kernel watches at the same time.
+ * Pages that can't be scanned are reported as written.
+ */
+static NTSTATUS kernel_writewatch_update( struct file_view *view, void *base, SIZE_T size, BOOL reset )
+{
+    struct page_region regions[64];
+    struct pm_scan_arg arg;
+    char *addr = base, *end = addr + size;
+    BYTE *p;
+    int i, ret;
+
+    while (addr < end)
+    {
+        memset( &arg, 0, sizeof(arg) );
+        arg.size = sizeof(arg);
+        arg.flags = reset ? PM_SCAN_WP_MATCHING | PM_SCAN_CHECK_WPASYNC : 0;
+        arg.start = (UINT_PTR)addr;
+        arg.end = (UINT_PTR)end;
+        arg.vec = (UINT_PTR)regions;
+        arg.vec_len = sizeof(regions) / sizeof(regions[0]);
+        arg.category_mask = PAGE_IS_WRITTEN;
+        arg.return_mask = PAGE_IS_WRITTEN;
+
+        if ((ret = ioctl( pagemap_fd, PAGEMAP_SCAN, &arg )) == -1)
+        {
+            NTSTATUS status = FILE_GetNtStatus();
+
+            ERR( "failed to get write watches for %p-%p: %s\n", addr, end, strerror(errno) );
+            p = view->prot + ((addr - (char *)view->base) >> page_shift);
+            for ( ; addr < end; addr += page_size) *p++ &= ~VPROT_WRITEWATCH;
+            return status;
+        }
+        for (i = 0; i < ret; i++)
+        {
+            SIZE_T count = (regions[i].end - regions[i].start) >> page_shift;
+
+            p = view->prot + (((char *)(UINT_PTR)regions[i].start - (char *)view->base) >> page_shift);
+            while (count--) *p++ &= ~VPROT_WRITEWATCH;
+        }
+        addr = (char *)(UINT_PTR)arg.walk_end;
+    }
+    return STATUS_SUCCESS;
+}
+
+#else  /* __linux__ */
+
+static void kernel_writewatch_init(void)
+{
+}
+
+static NTSTATUS kernel_writewatch_reset( void *base, SIZE_T size )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+static NTSTATUS kernel_writewatch_register( void *base, SIZE_T size )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+static NTSTATUS kernel_writewatch_update( struct file_view *view, void *base, SIZE_T size, BOOL reset )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+#endif  /* __linux__ */
+
+
 /***********************************************************************
  *           reset_write_watches
  *
@@ -676,6 +959,12 @@ static void reset_write_watches( struct file_view *view, void *base, SIZE_T size
     char *addr = base;
     BYTE *p = view->prot + ((addr - (char *)view->base) >> page_shift);
 
+    if (use_kernel_writewatch)  /* the pages don't need to be protected */
+    {
+        for (i = 0; i < size >> page_shift; i++) p[i] |= VPROT_WRITEWATCH;
+        return;
+    }
+
     p[0] |= VPROT_WRITEWATCH;
     unix_prot = VIRTUAL_GetUnixProt( p[0] );
     for (count = i = 1; i < size >> page_shift; i++, count++)
@@ -950,11 +1239,21 @@ static SIZE_T get_committed_size( struct file_view *view, void *base, BYTE *vpro
  */
 static NTSTATUS decommit_pages( struct file_view *view, size_t start, size_t size )
 {
+    BOOL kernel_writewatch = use_kernel_writewatch && (view->protect & VPROT_WRITEWATCH);
+
+    /* the pages written so far must remain reported after the decommit */
+    if (kernel_writewatch) kernel_writewatch_update( view, (char *)view->base + start, size, FALSE );
+
     if (wine_anon_mmap( (char *)view->base + start, size, PROT_NONE, MAP_FIXED ) != (void *)-1)
     {
         BYTE *p = view->prot + (start >> page_shift);
+        BYTE clear = VPROT_COMMITTED;
+
+        /* the new mapping needs to be tracked again, report it as written if that's not possible */
+        if (kernel_writewatch && kernel_writewatch_register( (char *)view->base + start, size ))
+            clear |= VPROT_WRITEWATCH;
         size >>= page_shift;
-        while (size--) *p++ &= ~VPROT_COMMITTED;
+        while (size--) *p++ &= ~clear;
         return STATUS_SUCCESS;
     }
     return FILE_GetNtStatus();
@@ -1045,6 +1344,100 @@ static NTSTATUS stat_mapping_file( struct file_view *view, struct stat *st )
 }
 
 
+/***********************************************************************
+ *           get_reloc_cache
+ *
+ * Retrieve the relocated image contents cached by the server for a mapping.
+ */
+static char *get_reloc_cache( HANDLE mapping, HANDLE *cache )
+{
+    char *base = NULL;
+
+    *cache = 0;
+    SERVER_START_REQ( get_mapping_reloc_cache )
+    {
+        req->handle = wine_server_obj_handle( mapping );
+        if (!wine_server_call( req ) && reply->cache)
+        {
+            base = wine_server_get_ptr( reply->base );
+            *cache = wine_server_ptr_handle( reply->cache );
+        }
+    }
+    SERVER_END_REQ;
+    return base;
+}
+
+
+/***********************************************************************
+ *           get_reloc_cache_range
+ *
+ * Compute the range of a relocated image that can be cached for other
+ * processes. Return FALSE if the image can't be cached.
+ */
+static BOOL get_reloc_cache_range( const IMAGE_SECTION_HEADER *sec, const SIZE_T *data_size,
+                                   unsigned int nb_sec, const char *ptr, const IMAGE_DATA_DIRECTORY *relocs,
+                                   UINT *start, UINT *end )
+{
+    const IMAGE_BASE_RELOCATION *rel, *rel_end;
+    int i;
+
+    *start = *end = 0;
+    for (i = 0; i < nb_sec; i++)
+    {
+        /* the contents are read after the image protections have been set */
+        if (!(sec[i].Characteristics & (IMAGE_SCN_MEM_READ | IMAGE_SCN_MEM_WRITE | IMAGE_SCN_MEM_EXECUTE)))
+            return FALSE;
+        if (!data_size[i]) continue;
+        if (!*end || sec[i].VirtualAddress < *start) *start = sec[i].VirtualAddress;
+        if (sec[i].VirtualAddress + data_size[i] > *end) *end = sec[i].VirtualAddress + data_size[i];
+    }
+    if (!*end) return FALSE;
+
+    /* only the section data is mapped from the cache, so all the fixups have to be inside it */
+    rel = (const IMAGE_BASE_RELOCATION *)(ptr + relocs->VirtualAddress);
+    rel_end = (const IMAGE_BASE_RELOCATION *)(ptr + relocs->VirtualAddress + relocs->Size);
+    while (rel < rel_end - 1 && rel->SizeOfBlock)
+    {
+        for (i = 0; i < nb_sec; i++)
+            if (rel->VirtualAddress >= sec[i].VirtualAddress &&
+                rel->VirtualAddress < sec[i].VirtualAddress + data_size[i]) break;
+        if (i == nb_sec) return FALSE;
+        rel = (const IMAGE_BASE_RELOCATION *)((const char *)rel + rel->SizeOfBlock);
+    }
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           create_reloc_cache
+ *
+ * Send the relocated image contents to the server, so that other
+ * processes loading the same image at the same address can map them
+ * instead of relocating the image again.
+ */
+static void create_reloc_cache( HANDLE mapping, char *ptr, UINT start, UINT end )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    UINT size;
+
+    /* send the contents in bounded chunks so that the server isn't blocked for too long */
+    for ( ; start < end && !status; start += size)
+    {
+        size = min( end - start, RELOC_CACHE_MAX_CHUNK );
+        SERVER_START_REQ( create_mapping_reloc_cache )
+        {
+            req->handle = wine_server_obj_handle( mapping );
+            req->base   = wine_server_client_ptr( ptr );
+            req->offset = start;
+            req->end    = end;
+            wine_server_add_data( req, ptr + start, size );
+            status = wine_server_call( req );
+        }
+        SERVER_END_REQ;
+    }
+}
+
+
 /***********************************************************************
  *           map_image
  *
@@ -1065,6 +1458,12 @@ static NTSTATUS map_image( HANDLE hmapping, int fd, char *base, SIZE_T total_siz
     struct stat st;
     struct file_view *view = NULL;
     char *ptr, *header_end, *header_start;
+    char *cache_base = NULL;
+    HANDLE cache = 0;
+    int cache_fd = -1, cache_needs_close = 0;
+    SIZE_T data_size[96];
+    UINT cache_start, cache_end = 0;
+    BOOL relocate;
     INT_PTR delta = 0;
 
     /* zero-map the whole range */
@@ -1075,6 +1474,12 @@ static NTSTATUS map_image( HANDLE hmapping, int fd, char *base, SIZE_T total_siz
         status = map_view( &view, base, total_size, mask, FALSE,
                            VPROT_COMMITTED | VPROT_READ | VPROT_EXEC | VPROT_WRITECOPY | VPROT_IMAGE );
 
+    /* try the address where another process already relocated the image */
+    if (status != STATUS_SUCCESS && dup_mapping &&
+        (cache_base = get_reloc_cache( hmapping, &cache )) >= (char *)address_space_start)
+        status = map_view( &view, cache_base, total_size, mask, FALSE,
+                           VPROT_COMMITTED | VPROT_READ | VPROT_EXEC | VPROT_WRITECOPY | VPROT_IMAGE );
+
     if (status != STATUS_SUCCESS)
         status = map_view( &view, NULL, total_size, mask, FALSE,
                            VPROT_COMMITTED | VPROT_READ | VPROT_EXEC | VPROT_WRITECOPY | VPROT_IMAGE );
@@ -1112,6 +1517,14 @@ static NTSTATUS map_image( HANDLE hmapping, int fd, char *base, SIZE_T total_siz
     imports = nt->OptionalHeader.DataDirectory + IMAGE_DIRECTORY_ENTRY_IMPORT;
     if (!imports->Size || !imports->VirtualAddress) imports = NULL;
 
+    relocate = (ptr != base &&
+                ((nt->FileHeader.Characteristics & IMAGE_FILE_DLL) ||
+                 !NtCurrentTeb()->Peb->ImageBaseAddress));
+
+    if (ptr == cache_base && relocate && !(nt->FileHeader.Characteristics & IMAGE_FILE_RELOCS_STRIPPED) &&
+        server_get_unix_fd( cache, 0, &cache_fd, &cache_needs_close, NULL, NULL ))
+        cache_fd = -1;
+
     /* check for non page-aligned binary */
 
     if (nt->OptionalHeader.SectionAlignment <= page_mask)
@@ -1146,6 +1559,8 @@ static NTSTATUS map_image( HANDLE hmapping, int fd, char *base, SIZE_T total_siz
         static const SIZE_T sector_align = 0x1ff;
         SIZE_T map_size, file_start, file_size, end;
 
+        data_size[i] = 0;
+
         if (!sec->Misc.VirtualSize)
             map_size = ROUND_SIZE( 0, sec->SizeOfRawData );
         else
@@ -1202,14 +1617,34 @@ static NTSTATUS map_image( HANDLE hmapping, int fd, char *base, SIZE_T total_siz
 
         if (!sec->PointerToRawData || !file_size) continue;
 
+        /* the data pages, including the cleared end of the last one */
+        data_size[i] = min( ROUND_SIZE( 0, file_size ), map_size );
+
         /* Note: if the section is not aligned properly map_file_into_view will magically
          *       fall back to read(), so we don't need to check anything here.
          */
         end = file_start + file_size;
         if (sec->PointerToRawData >= st.st_size ||
             end > ((st.st_size + sector_align) & ~sector_align) ||
-            end < file_start ||
-            map_file_into_view( view, fd, sec->VirtualAddress, file_size, file_start,
+            end < file_start)
+        {
+            ERR_(module)( "Could not map section %.8s, file probably truncated\n", sec->Name );
+            goto error;
+        }
+
+        if (cache_fd != -1)
+        {
+            /* the cached contents are already relocated and cleared */
+            if (map_file_into_view( view, cache_fd, sec->VirtualAddress, data_size[i], sec->VirtualAddress,
+                                    VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY, FALSE ) != STATUS_SUCCESS)
+            {
+                ERR_(module)( "Could not map cached section %.8s\n", sec->Name );
+                goto error;
+            }
+            continue;
+        }
+
+        if (map_file_into_view( view, fd, sec->VirtualAddress, file_size, file_start,
                                 VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY,
                                 !dup_mapping ) != STATUS_SUCCESS)
         {
@@ -1219,8 +1654,7 @@ static NTSTATUS map_image( HANDLE hmapping, int fd, char *base, SIZE_T total_siz
 
         if (file_size & page_mask)
         {
-            end = ROUND_SIZE( 0, file_size );
-            if (end > map_size) end = map_size;
+            end = data_size[i];
             TRACE_(module)("clearing %p - %p\n",
                            ptr + sec->VirtualAddress + file_size,
                            ptr + sec->VirtualAddress + end );
@@ -1231,9 +1665,7 @@ static NTSTATUS map_image( HANDLE hmapping, int fd, char *base, SIZE_T total_siz
 
     /* perform base relocation, if necessary */
 
-    if (ptr != base &&
-        ((nt->FileHeader.Characteristics & IMAGE_FILE_DLL) ||
-          !NtCurrentTeb()->Peb->ImageBaseAddress) )
+    if (relocate)
     {
         IMAGE_BASE_RELOCATION *rel, *end;
         const IMAGE_DATA_DIRECTORY *relocs;
@@ -1254,6 +1686,8 @@ static NTSTATUS map_image( HANDLE hmapping, int fd, char *base, SIZE_T total_siz
         end = (IMAGE_BASE_RELOCATION *)(ptr + relocs->VirtualAddress + relocs->Size);
         delta = ptr - base;
 
+        if (cache_fd != -1) rel = end;  /* already relocated */
+
         while (rel < end - 1 && rel->SizeOfBlock)
         {
             if (rel->VirtualAddress >= total_size)
@@ -1267,6 +1701,12 @@ static NTSTATUS map_image( HANDLE hmapping, int fd, char *base, SIZE_T total_siz
                                              (USHORT *)(rel + 1), delta );
             if (!rel) goto error;
         }
+
+        /* publish the relocated contents, unless another process already did */
+        if (cache_fd == -1 && !cache && dup_mapping &&
+            !get_reloc_cache_range( sections, data_size, nt->FileHeader.NumberOfSections,
+                                    ptr, relocs, &cache_start, &cache_end ))
+            cache_end = 0;
     }
 
     /* set the image protections */
@@ -1302,6 +1742,9 @@ static NTSTATUS map_image( HANDLE hmapping, int fd, char *base, SIZE_T total_siz
     view->mapping = dup_mapping;
     view->map_protect = map_vprot;
     server_leave_uninterrupted_section( &csVirtual, &sigset );
+    if (cache_needs_close) close( cache_fd );
+    if (cache) NtClose( cache );
+    if (cache_end) create_reloc_cache( hmapping, ptr, cache_start, cache_end );
 
     *addr_ptr = ptr;
 #ifdef VALGRIND_LOAD_PDB_DEBUGINFO
@@ -1313,6 +1756,8 @@ static NTSTATUS map_image( HANDLE hmapping, int fd, char *base, SIZE_T total_siz
  error:
     if (view) delete_view( view );
     server_leave_uninterrupted_section( &csVirtual, &sigset );
+    if (cache_needs_close) close( cache_fd );
+    if (cache) NtClose( cache );
     if (dup_mapping) NtClose( dup_mapping );
     return status;
 }
@@ -1360,6 +1805,9 @@ void virtual_init(void)
         }
     }
 
+    wine_rb_init( &views_tree, &views_tree_functions );
+    kernel_writewatch_init();
+
     /* try to find space in a reserved area for the virtual heap */
     if (!wine_mmap_enum_reserved_areas( alloc_virtual_heap, &heap_base, 1 ))
         heap_base = wine_anon_mmap( NULL, VIRTUAL_HEAP_SIZE, PROT_READ|PROT_WRITE, 0 );
@@ -1527,7 +1975,7 @@ NTSTATUS virtual_handle_fault( LPCVOID addr, DWORD err )
             VIRTUAL_SetProt( view, page, page_size, *vprot & ~VPROT_GUARD );
             ret = STATUS_GUARD_PAGE_VIOLATION;
         }
-        if ((err & EXCEPTION_WRITE_FAULT) && (view->protect & VPROT_WRITEWATCH))
+        if ((err & EXCEPTION_WRITE_FAULT) && (view->protect & VPROT_WRITEWATCH) && !use_kernel_writewatch)
         {
             if (*vprot & VPROT_WRITEWATCH)
             {
@@ -1893,6 +2341,12 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG zero_
     {
         if (type & MEM_WRITE_WATCH) vprot |= VPROT_WRITEWATCH;
         status = map_view( &view, base, size, mask, type & MEM_TOP_DOWN, vprot );
+        if (status == STATUS_SUCCESS && use_kernel_writewatch && (vprot & VPROT_WRITEWATCH) &&
+            (status = kernel_writewatch_register( view->base, view->size )))
+        {
+            delete_view( view );
+            view = NULL;
+        }
         if (status == STATUS_SUCCESS) base = view->base;
     }
     else if (type & MEM_RESET)
@@ -2231,30 +2685,24 @@ NTSTATUS WINAPI NtQueryVirtualMemory( HANDLE process, LPCVOID addr,
     /* Find the view containing the address */
 
     server_enter_uninterrupted_section( &csVirtual, &sigset );
-    ptr = list_head( &views_list );
-    for (;;)
+    if ((view = find_view_below( base )) && (char *)view->base + view->size > base)
     {
-        if (!ptr)
-        {
-            size = (char *)working_set_limit - alloc_base;
-            view = NULL;
-            break;
-        }
-        view = LIST_ENTRY( ptr, struct file_view, entry );
-        if ((char *)view->base > base)
-        {
-            size = (char *)view->base - alloc_base;
-            view = NULL;
-            break;
-        }
-        if ((char *)view->base + view->size > base)
+        alloc_base = view->base;
+        size = view->size;
+    }
+    else
+    {
+        /* free range between the previous view and the next one */
+        if (view)
         {
-            alloc_base = view->base;
-            size = view->size;
-            break;
+            alloc_base = (char *)view->base + view->size;
+            ptr = list_next( &views_list, &view->entry );
         }
-        alloc_base = (char *)view->base + view->size;
-        ptr = list_next( &views_list, ptr );
+        else ptr = list_head( &views_list );
+
+        if (ptr) size = (char *)LIST_ENTRY( ptr, struct file_view, entry )->base - alloc_base;
+        else size = (char *)working_set_limit - alloc_base;
+        view = NULL;
     }
 
     /* Fill the info structure */
@@ -2766,6 +3214,11 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
         char *addr = base;
         char *end = addr + size;
 
+        /* if the kernel state can't be retrieved, the pages stay reported as written */
+        if (use_kernel_writewatch &&
+            kernel_writewatch_update( view, base, size, flags & WRITE_WATCH_FLAG_RESET ))
+            flags &= ~WRITE_WATCH_FLAG_RESET;
+
         while (pos < *count && addr < end)
         {
             BYTE prot = view->prot[(addr - (char *)view->base) >> page_shift];
@@ -2803,7 +3256,11 @@ NTSTATUS WINAPI NtResetWriteWatch( HANDLE process, PVOID base, SIZE_T size )
     server_enter_uninterrupted_section( &csVirtual, &sigset );
 
     if ((view = VIRTUAL_FindView( base, size )) && (view->protect & VPROT_WRITEWATCH))
-        reset_write_watches( view, base, size );
+    {
+        /* if the kernel can't track the range, the pages stay reported as written */
+        if (!use_kernel_writewatch || !kernel_writewatch_reset( base, size ))
+            reset_write_watches( view, base, size );
+    }
     else
         status = STATUS_INVALID_PARAMETER;
 
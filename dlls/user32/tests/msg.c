@@ -10431,6 +10431,45 @@ done:
     flush_events();
 }
 
+static void test_PeekMessage3(void)
+{
+    MSG msg;
+    BOOL ret;
+    int i;
+
+    flush_events();
+
+    for (i = 0; i < 3000; i++)
+    {
+        ret = PostThreadMessageA( GetCurrentThreadId(), WM_USER + i % 3, i, 0 );
+        ok( ret, "PostThreadMessage %d failed, error %u\n", i, GetLastError() );
+    }
+
+    /* filtered messages are retrieved in posting order */
+    for (i = 2; i < 3000; i += 3)
+    {
+        ret = PeekMessageA( &msg, (HWND)-1, WM_USER + 2, WM_USER + 2, PM_REMOVE );
+        ok( ret, "%d: no message available\n", i );
+        if (!ret) break;
+        ok( msg.message == WM_USER + 2, "%d: got message %04x\n", i, msg.message );
+        ok( msg.wParam == i, "%d: got wparam %lu\n", i, msg.wParam );
+    }
+    ret = PeekMessageA( &msg, (HWND)-1, WM_USER + 2, WM_USER + 2, PM_REMOVE );
+    ok( !ret, "unexpected message %04x\n", msg.message );
+
+    for (i = 0; i < 3000; i++)
+    {
+        if (i % 3 == 2) continue;
+        ret = PeekMessageA( &msg, (HWND)-1, WM_USER, WM_USER + 1, PM_REMOVE );
+        ok( ret, "%d: no message available\n", i );
+        if (!ret) break;
+        ok( msg.message == WM_USER + i % 3, "%d: got message %04x\n", i, msg.message );
+        ok( msg.wParam == i, "%d: got wparam %lu\n", i, msg.wParam );
+    }
+    ret = PeekMessageA( &msg, 0, 0, 0, PM_REMOVE );
+    ok( !ret, "unexpected message %04x\n", msg.message );
+}
+
 static INT_PTR CALLBACK wm_quit_dlg_proc(HWND hwnd, UINT message, WPARAM wp, LPARAM lp)
 {
     struct recvd_message msg;
@@ -14553,6 +14592,7 @@ START_TEST(msg)
     test_ShowWindow();
     test_PeekMessage();
     test_PeekMessage2();
+    test_PeekMessage3();
     test_WaitForInputIdle( test_argv[0] );
     test_scrollwindowex();
     test_messages();
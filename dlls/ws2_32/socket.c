@@ -63,6 +63,9 @@
 #ifdef HAVE_SYS_UIO_H
 # include <sys/uio.h>
 #endif
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
 #ifdef HAVE_SYS_SOCKET_H
 #include <sys/socket.h>
 #endif
@@ -351,6 +354,20 @@ typedef struct ws2_async
     struct iovec                        iovec[1];
 } ws2_async;
 
+struct ws2_transmit_async
+{
+    HANDLE                    hSocket;
+    DWORD                     flags;       /* TF_* flags */
+    DWORD                     send_size;   /* max size of a single send */
+    DWORD                     count;       /* number of elements */
+    DWORD                     current;     /* element being sent */
+    ULONGLONG                 offset;      /* bytes of the current element already sent */
+    char                     *buffer;      /* buffer for files that can't be sent directly */
+    size_t                    buffer_pos;  /* position of the data left to send in the buffer */
+    size_t                    buffer_len;  /* length of the data in the buffer */
+    TRANSMIT_PACKETS_ELEMENT  elements[1];
+};
+
 typedef struct ws2_accept_async
 {
     HANDLE              listen_socket;
@@ -864,6 +881,52 @@ static void _enable_event( HANDLE s, unsigned int event,
     SERVER_END_REQ;
 }
 
+/* Sockets created by this process on which no network events were ever selected,
+ * indexed by handle. The server only reports held events once some are selected,
+ * so there's no need to re-enable FD_READ/FD_WRITE after each operation on those. */
+#define SOCKET_FLAGS_BLOCK_SIZE  4096
+#define SOCKET_FLAGS_BLOCKS      256
+
+static BYTE *socket_no_events[SOCKET_FLAGS_BLOCKS];
+
+static BYTE *get_socket_flag( HANDLE s, BOOL alloc )
+{
+    ULONG_PTR idx = (ULONG_PTR)s / 4;
+    ULONG_PTR block = idx / SOCKET_FLAGS_BLOCK_SIZE;
+    BYTE *ptr;
+
+    if (block >= SOCKET_FLAGS_BLOCKS) return NULL;
+    if (!(ptr = socket_no_events[block]))
+    {
+        if (!alloc) return NULL;
+        if (!(ptr = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, SOCKET_FLAGS_BLOCK_SIZE ))) return NULL;
+        if (InterlockedCompareExchangePointer( (void **)&socket_no_events[block], ptr, NULL ))
+        {
+            HeapFree( GetProcessHeap(), 0, ptr );
+            ptr = socket_no_events[block];
+        }
+    }
+    return ptr + idx % SOCKET_FLAGS_BLOCK_SIZE;
+}
+
+static void set_socket_no_events( HANDLE s, BOOL no_events )
+{
+    BYTE *flag = get_socket_flag( s, no_events );
+    if (flag) *flag = no_events;
+}
+
+static BOOL socket_has_no_events( HANDLE s )
+{
+    BYTE *flag = get_socket_flag( s, FALSE );
+    return flag && *flag;
+}
+
+/* re-enable a network event after a send or receive operation */
+static inline void _reenable_event( HANDLE s, unsigned int event )
+{
+    if (!socket_has_no_events( s )) _enable_event( s, event, 0, 0 );
+}
+
 static NTSTATUS _is_blocking(SOCKET s, BOOL *ret)
 {
     NTSTATUS status;
@@ -1648,6 +1711,8 @@ static INT WS_DuplicateSocket(BOOL unicode, SOCKET s, DWORD dwProcessId, LPWSAPR
      * the target use the global duplicate, or we could copy a reference to us to the structure
      * and let the target duplicate it from us, but let's do it as simple as possible */
     memcpy(lpProtocolInfo, &infow, size);
+    /* the other process may select events on it */
+    set_socket_no_events( SOCKET2HANDLE(s), FALSE );
     DuplicateHandle(GetCurrentProcess(), SOCKET2HANDLE(s),
                     hProcess, (LPHANDLE)&lpProtocolInfo->dwServiceFlags3,
                     0, FALSE, DUPLICATE_SAME_ACCESS);
@@ -1985,14 +2050,14 @@ static NTSTATUS WS2_async_recv( void* user, IO_STATUS_BLOCK* iosb, NTSTATUS stat
         if (result >= 0)
         {
             status = STATUS_SUCCESS;
-            _enable_event( wsa->hSocket, FD_READ, 0, 0 );
+            _reenable_event( wsa->hSocket, FD_READ );
         }
         else
         {
             if (errno == EAGAIN)
             {
                 status = STATUS_PENDING;
-                _enable_event( wsa->hSocket, FD_READ, 0, 0 );
+                _reenable_event( wsa->hSocket, FD_READ );
             }
             else
             {
@@ -2351,6 +2416,8 @@ SOCKET WINAPI WS_accept(SOCKET s, struct WS_sockaddr *addr, int *addrlen32)
         SERVER_END_REQ;
         if (!status)
         {
+            /* the accepted socket gets the events selected on the listening one */
+            if (socket_has_no_events( SOCKET2HANDLE(s) )) set_socket_no_events( SOCKET2HANDLE(as), TRUE );
             if (addr && WS_getpeername(as, addr, addrlen32))
             {
                 WS_closesocket(as);
@@ -2728,6 +2795,7 @@ int WINAPI WS_bind(SOCKET s, const struct WS_sockaddr* name, int namelen)
 int WINAPI WS_closesocket(SOCKET s)
 {
     TRACE("socket %04lx\n", s);
+    set_socket_no_events( SOCKET2HANDLE(s), FALSE );
     if (CloseHandle(SOCKET2HANDLE(s))) return 0;
     return SOCKET_ERROR;
 }
@@ -2956,6 +3024,332 @@ connection_success:
     return TRUE;
 }
 
+/* max number of bytes sent from a single async callback, so that the thread doesn't get stuck in it */
+#define TRANSMIT_ASYNC_MAX_BYTES 0x100000
+
+/* send as much of a memory element as possible without blocking */
+static NTSTATUS transmit_buffer( int fd, struct ws2_transmit_async *wsa, const TRANSMIT_PACKETS_ELEMENT *elem,
+                                 ULONG_PTR *sent, ULONG_PTR max )
+{
+    size_t len;
+    ssize_t ret;
+
+    while (wsa->offset < elem->cLength)
+    {
+        if (*sent >= max) return STATUS_PENDING;
+        len = elem->cLength - wsa->offset;
+        if (wsa->send_size) len = min( len, wsa->send_size );
+        if ((ret = send( fd, (char *)elem->u.pBuffer + wsa->offset, len, 0 )) == -1)
+        {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) return STATUS_PENDING;
+            return sock_get_ntstatus( errno );
+        }
+        wsa->offset += ret;
+        *sent += ret;
+    }
+    return STATUS_SUCCESS;
+}
+
+/* send as much of a file element as possible without blocking, without copying the data
+ * through user space when possible */
+static NTSTATUS transmit_file( int fd, struct ws2_transmit_async *wsa, const TRANSMIT_PACKETS_ELEMENT *elem,
+                               ULONG_PTR *sent, ULONG_PTR max )
+{
+    /* offset -1 means the current file position */
+    BOOL use_current = (elem->u.s.nFileOffset.QuadPart == -1);
+    DWORD chunk = wsa->send_size ? wsa->send_size : 0x10000;
+    NTSTATUS status;
+    ssize_t ret;
+    size_t count;
+    int file_fd;
+
+    if ((status = wine_server_handle_to_fd( elem->u.s.hFile, FILE_READ_DATA, &file_fd, NULL ))) return status;
+
+    for (;;)
+    {
+        if (*sent >= max)
+        {
+            status = STATUS_PENDING;
+            break;
+        }
+
+        /* first send what is left over in the buffer from a previous read */
+        if (wsa->buffer_pos < wsa->buffer_len)
+        {
+            if ((ret = send( fd, wsa->buffer + wsa->buffer_pos, wsa->buffer_len - wsa->buffer_pos, 0 )) == -1)
+            {
+                if (errno == EINTR) continue;
+                status = (errno == EAGAIN) ? STATUS_PENDING : sock_get_ntstatus( errno );
+                break;
+            }
+            wsa->buffer_pos += ret;
+            wsa->offset += ret;
+            *sent += ret;
+            continue;
+        }
+
+        /* len 0 means up to the end of the file */
+        if (elem->cLength && wsa->offset >= elem->cLength) break;
+        count = elem->cLength ? min( elem->cLength - wsa->offset, chunk ) : chunk;
+
+#ifdef HAVE_SYS_SENDFILE_H
+        if (!wsa->buffer)
+        {
+            off_t pos = elem->u.s.nFileOffset.QuadPart + wsa->offset;
+
+            if ((ret = sendfile( fd, file_fd, use_current ? NULL : &pos, count )) == -1)
+            {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN)
+                {
+                    status = STATUS_PENDING;
+                    break;
+                }
+                if (errno != EINVAL && errno != ENOSYS)
+                {
+                    status = sock_get_ntstatus( errno );
+                    break;
+                }
+                /* not supported for this kind of file, fall back to copying the data */
+            }
+            else
+            {
+                if (!ret) break;
+                wsa->offset += ret;
+                *sent += ret;
+                continue;
+            }
+        }
+#endif
+        if (!wsa->buffer && !(wsa->buffer = HeapAlloc( GetProcessHeap(), 0, chunk )))
+        {
+            status = STATUS_NO_MEMORY;
+            break;
+        }
+        if (use_current) ret = read( file_fd, wsa->buffer, count );
+        else ret = pread( file_fd, wsa->buffer, count, elem->u.s.nFileOffset.QuadPart + wsa->offset );
+        if (ret == -1)
+        {
+            if (errno == EINTR) continue;
+            status = sock_get_ntstatus( errno );
+            break;
+        }
+        if (!ret) break;
+        wsa->buffer_pos = 0;
+        wsa->buffer_len = ret;
+    }
+
+    wine_server_release_fd( elem->u.s.hFile, file_fd );
+    return status;
+}
+
+/* send the elements of a TransmitPackets request without blocking */
+/* returns STATUS_PENDING when the socket isn't writable, or after sending max bytes */
+static NTSTATUS transmit_packets( int fd, struct ws2_transmit_async *wsa, ULONG_PTR *sent, ULONG_PTR max )
+{
+    const TRANSMIT_PACKETS_ELEMENT *elem;
+    NTSTATUS status = STATUS_SUCCESS;
+
+    for ( ; wsa->current < wsa->count; wsa->current++)
+    {
+        elem = &wsa->elements[wsa->current];
+        if (elem->dwElFlags & TP_ELEMENT_FILE)
+            status = transmit_file( fd, wsa, elem, sent, max );
+        else if (elem->dwElFlags & TP_ELEMENT_MEMORY)
+            status = transmit_buffer( fd, wsa, elem, sent, max );
+        if (status) return status;
+        wsa->offset = 0;
+    }
+    if ((wsa->flags & TF_DISCONNECT) && shutdown( fd, SHUT_WR ) == -1 && errno != ENOTCONN)
+        return sock_get_ntstatus( errno );
+    return STATUS_SUCCESS;
+}
+
+static void free_transmit_async( struct ws2_transmit_async *wsa )
+{
+    HeapFree( GetProcessHeap(), 0, wsa->buffer );
+    HeapFree( GetProcessHeap(), 0, wsa );
+}
+
+/***********************************************************************
+ *              ws2_transmit_apc          (INTERNAL)
+ */
+static void WINAPI ws2_transmit_apc( void *arg, IO_STATUS_BLOCK *iosb, ULONG reserved )
+{
+    free_transmit_async( arg );
+}
+
+/***********************************************************************
+ *              WS2_async_transmit        (INTERNAL)
+ *
+ * Handler for overlapped TransmitFile() and TransmitPackets() operations.
+ */
+static NTSTATUS WS2_async_transmit( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS status, void **apc )
+{
+    struct ws2_transmit_async *wsa = user;
+    ULONG_PTR sent = 0;
+    int fd;
+
+    if (status == STATUS_ALERTED)
+    {
+        if (!(status = wine_server_handle_to_fd( wsa->hSocket, FILE_WRITE_DATA, &fd, NULL )))
+        {
+            status = transmit_packets( fd, wsa, &sent, TRANSMIT_ASYNC_MAX_BYTES );
+            wine_server_release_fd( wsa->hSocket, fd );
+        }
+        iosb->Information += sent;
+    }
+    if (status != STATUS_PENDING)
+    {
+        iosb->u.Status = status;
+        *apc = ws2_transmit_apc;
+    }
+    return status;
+}
+
+/***********************************************************************
+ *     TransmitPackets
+ */
+static BOOL WINAPI WS2_TransmitPackets( SOCKET s, LPTRANSMIT_PACKETS_ELEMENT elements, DWORD count,
+                                        DWORD send_size, LPOVERLAPPED overlapped, DWORD flags )
+{
+    ULONG_PTR cvalue = (overlapped && ((ULONG_PTR)overlapped->hEvent & 1) == 0) ? (ULONG_PTR)overlapped : 0;
+    struct ws2_transmit_async *wsa;
+    NTSTATUS status;
+    ULONG_PTR sent = 0;
+    unsigned int options;
+    int fd;
+
+    TRACE("socket %04lx, elements %p, count %u, send_size %u, ov %p, flags %x\n",
+          s, elements, count, send_size, overlapped, flags);
+
+    if (flags & TF_REUSE_SOCKET) FIXME("TF_REUSE_SOCKET not supported\n");
+
+    fd = get_sock_fd( s, FILE_WRITE_DATA, &options );
+    if (fd == -1) return FALSE;
+
+    if (!(wsa = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct ws2_transmit_async, elements[count] ))))
+    {
+        release_sock_fd( s, fd );
+        WSASetLastError( WSAENOBUFS );
+        return FALSE;
+    }
+    wsa->hSocket    = SOCKET2HANDLE(s);
+    wsa->flags      = flags;
+    wsa->send_size  = send_size;
+    wsa->count      = count;
+    wsa->current    = 0;
+    wsa->offset     = 0;
+    wsa->buffer     = NULL;
+    wsa->buffer_pos = 0;
+    wsa->buffer_len = 0;
+    memcpy( wsa->elements, elements, count * sizeof(*elements) );
+
+    if (overlapped && !(options & (FILE_SYNCHRONOUS_IO_ALERT | FILE_SYNCHRONOUS_IO_NONALERT)))
+    {
+        IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)overlapped;
+
+        release_sock_fd( s, fd );
+
+        /* the data is sent from the async callback once the socket is writable */
+        iosb->u.Status = STATUS_PENDING;
+        iosb->Information = 0;
+
+        SERVER_START_REQ( register_async )
+        {
+            req->type           = ASYNC_TYPE_WRITE;
+            req->async.handle   = wine_server_obj_handle( wsa->hSocket );
+            req->async.callback = wine_server_client_ptr( WS2_async_transmit );
+            req->async.iosb     = wine_server_client_ptr( iosb );
+            req->async.arg      = wine_server_client_ptr( wsa );
+            req->async.event    = wine_server_obj_handle( overlapped->hEvent );
+            req->async.cvalue   = cvalue;
+            status = wine_server_call( req );
+        }
+        SERVER_END_REQ;
+
+        if (status != STATUS_PENDING) free_transmit_async( wsa );
+        WSASetLastError( NtStatusToWSAError( status ));
+        return FALSE;
+    }
+
+    /* synchronous transfer, wait for the socket to become writable when needed */
+    while ((status = transmit_packets( fd, wsa, &sent, ~(ULONG_PTR)0 )) == STATUS_PENDING)
+    {
+        struct pollfd pfd;
+
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+        poll( &pfd, 1, -1 );
+    }
+    release_sock_fd( s, fd );
+    free_transmit_async( wsa );
+
+    TRACE(" -> %lu bytes, status %08x\n", sent, status);
+
+    if (overlapped)
+    {
+        IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)overlapped;
+
+        iosb->u.Status = status;
+        iosb->Information = sent;
+    }
+    if (status)
+    {
+        WSASetLastError( NtStatusToWSAError( status ));
+        return FALSE;
+    }
+    if (overlapped)
+    {
+        if (cvalue) WS_AddCompletion( s, cvalue, STATUS_SUCCESS, sent );
+        if (overlapped->hEvent) SetEvent( overlapped->hEvent );
+    }
+    return TRUE;
+}
+
+/***********************************************************************
+ *     TransmitFile
+ */
+static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE file, DWORD file_bytes, DWORD bytes_per_send,
+                                     LPOVERLAPPED overlapped, LPTRANSMIT_FILE_BUFFERS buffers, DWORD flags )
+{
+    TRANSMIT_PACKETS_ELEMENT elements[3];
+    DWORD count = 0;
+
+    TRACE("socket %04lx, file %p, bytes %u, bytes_per_send %u, ov %p, buffers %p, flags %x\n",
+          s, file, file_bytes, bytes_per_send, overlapped, buffers, flags);
+
+    if (buffers && buffers->Head && buffers->HeadLength)
+    {
+        elements[count].dwElFlags = TP_ELEMENT_MEMORY;
+        elements[count].cLength   = buffers->HeadLength;
+        elements[count].u.pBuffer = buffers->Head;
+        count++;
+    }
+    if (file)
+    {
+        elements[count].dwElFlags = TP_ELEMENT_FILE;
+        elements[count].cLength   = file_bytes;
+        elements[count].u.s.hFile = file;
+        /* overlapped transfers start at the offset of the overlapped structure */
+        if (overlapped)
+            elements[count].u.s.nFileOffset.QuadPart = ((ULONGLONG)overlapped->u.s.OffsetHigh << 32) |
+                                                       overlapped->u.s.Offset;
+        else
+            elements[count].u.s.nFileOffset.QuadPart = -1;
+        count++;
+    }
+    if (buffers && buffers->Tail && buffers->TailLength)
+    {
+        elements[count].dwElFlags = TP_ELEMENT_MEMORY;
+        elements[count].cLength   = buffers->TailLength;
+        elements[count].u.pBuffer = buffers->Tail;
+        count++;
+    }
+    return WS2_TransmitPackets( s, elements, count, bytes_per_send, overlapped, flags );
+}
+
 
 /***********************************************************************
  *		getpeername		(WS2_32.5)
@@ -4031,11 +4425,13 @@ INT WINAPI WSAIoctl(SOCKET s, DWORD code, LPVOID in_buff, DWORD in_size, LPVOID
         }
         else if ( IsEqualGUID(&transmitfile_guid, in_buff) )
         {
-            FIXME("SIO_GET_EXTENSION_FUNCTION_POINTER: unimplemented TransmitFile\n");
+            *(LPFN_TRANSMITFILE *)out_buff = WS2_TransmitFile;
+            break;
         }
         else if ( IsEqualGUID(&transmitpackets_guid, in_buff) )
         {
-            FIXME("SIO_GET_EXTENSION_FUNCTION_POINTER: unimplemented TransmitPackets\n");
+            *(LPFN_TRANSMITPACKETS *)out_buff = WS2_TransmitPackets;
+            break;
         }
         else if ( IsEqualGUID(&wsarecvmsg_guid, in_buff) )
         {
@@ -4607,7 +5003,7 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
 
             /* Enable the event only after starting the async. The server will deliver it as soon as
                the async is done. */
-            _enable_event(SOCKET2HANDLE(s), FD_WRITE, 0, 0);
+            _reenable_event(SOCKET2HANDLE(s), FD_WRITE);
 
             if (err != STATUS_PENDING) HeapFree( GetProcessHeap(), 0, wsa );
             WSASetLastError( NtStatusToWSAError( err ));
@@ -4677,7 +5073,7 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
     else  /* non-blocking */
     {
         if (n < totalLength)
-            _enable_event(SOCKET2HANDLE(s), FD_WRITE, 0, 0);
+            _reenable_event(SOCKET2HANDLE(s), FD_WRITE);
         if (n == -1)
         {
             err = WSAEWOULDBLOCK;
@@ -5959,6 +6355,8 @@ int WINAPI WSAEventSelect(SOCKET s, WSAEVENT hEvent, LONG lEvent)
 
     TRACE("%08lx, hEvent %p, event %08x\n", s, hEvent, lEvent);
 
+    if (lEvent) set_socket_no_events( SOCKET2HANDLE(s), FALSE );
+
     SERVER_START_REQ( set_socket_event )
     {
         req->handle = wine_server_obj_handle( SOCKET2HANDLE(s) );
@@ -6028,6 +6426,8 @@ INT WINAPI WSAAsyncSelect(SOCKET s, HWND hWnd, UINT uMsg, LONG lEvent)
 
     TRACE("%lx, hWnd %p, uMsg %08x, event %08x\n", s, hWnd, uMsg, lEvent);
 
+    if (lEvent) set_socket_no_events( SOCKET2HANDLE(s), FALSE );
+
     SERVER_START_REQ( set_socket_event )
     {
         req->handle = wine_server_obj_handle( SOCKET2HANDLE(s) );
@@ -6223,6 +6623,7 @@ SOCKET WINAPI WSASocketW(int af, int type, int protocol,
     if (ret)
     {
         TRACE("\tcreated %04lx\n", ret );
+        set_socket_no_events( SOCKET2HANDLE(ret), TRUE );
         if (ipxptype > 0)
             set_ipx_packettype(ret, ipxptype);
        return ret;
@@ -6641,7 +7042,7 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             }
             else NtQueueApcThread( GetCurrentThread(), (PNTAPCFUNC)ws2_async_apc,
                                    (ULONG_PTR)wsa, (ULONG_PTR)iosb, 0 );
-            _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
+            _reenable_event(SOCKET2HANDLE(s), FD_READ);
             return 0;
         }
 
@@ -6671,13 +7072,13 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             {
                 err = WSAETIMEDOUT;
                 /* a timeout is not fatal */
-                _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
+                _reenable_event(SOCKET2HANDLE(s), FD_READ);
                 goto error;
             }
         }
         else
         {
-            _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
+            _reenable_event(SOCKET2HANDLE(s), FD_READ);
             err = WSAEWOULDBLOCK;
             goto error;
         }
@@ -6686,7 +7087,7 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
     TRACE(" -> %i bytes\n", n);
     if (wsa != &localwsa) HeapFree( GetProcessHeap(), 0, wsa );
     release_sock_fd( s, fd );
-    _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
+    _reenable_event(SOCKET2HANDLE(s), FD_READ);
 
     return 0;
 
@@ -4247,6 +4247,150 @@ end:
     HeapFree(GetProcessHeap(), 0, buffer);
 }
 
+static void check_transmitted_data(SOCKET dst, const char *expect, int size)
+{
+    char buf[8192];
+    int ret, total;
+
+    for (total = 0; total < size; total += ret)
+    {
+        ret = recv(dst, buf + total, sizeof(buf) - total, 0);
+        ok(ret > 0, "recv failed: %d\n", WSAGetLastError());
+        if (ret <= 0) break;
+    }
+    ok(total == size, "received %d bytes, expected %d\n", total, size);
+    ok(!memcmp(buf, expect, size), "wrong data\n");
+}
+
+static void test_TransmitFile(void)
+{
+    GUID transmitFileGuid = WSAID_TRANSMITFILE;
+    GUID transmitPacketsGuid = WSAID_TRANSMITPACKETS;
+    LPFN_TRANSMITFILE pTransmitFile = NULL;
+    LPFN_TRANSMITPACKETS pTransmitPackets = NULL;
+    TRANSMIT_FILE_BUFFERS buffers;
+    TRANSMIT_PACKETS_ELEMENT elements[3];
+    SOCKET src = INVALID_SOCKET, dst = INVALID_SOCKET;
+    char path[MAX_PATH], filename[MAX_PATH], head[] = "head", tail[] = "tail";
+    char data[4096], expect[sizeof(data) + 8];
+    HANDLE file, port, event;
+    OVERLAPPED ov, *ovp;
+    ULONG_PTR key;
+    DWORD written, bytes;
+    int ret, i;
+    BOOL bret;
+
+    if (tcp_socketpair(&src, &dst) != 0)
+    {
+        ok(0, "creating socket pair failed, skipping test\n");
+        return;
+    }
+
+    ret = WSAIoctl(src, SIO_GET_EXTENSION_FUNCTION_POINTER, &transmitFileGuid, sizeof(transmitFileGuid),
+                   &pTransmitFile, sizeof(pTransmitFile), &written, NULL, NULL);
+    ok(!ret, "WSAIoctl failed: %d\n", WSAGetLastError());
+    if (!pTransmitFile)
+    {
+        win_skip("TransmitFile not available\n");
+        goto end;
+    }
+
+    GetTempPathA(MAX_PATH, path);
+    GetTempFileNameA(path, "wst", 0, filename);
+    file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                       FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "CreateFile failed: %u\n", GetLastError());
+    for (i = 0; i < sizeof(data); i++) data[i] = (char)i;
+    bret = WriteFile(file, data, sizeof(data), &written, NULL);
+    ok(bret && written == sizeof(data), "WriteFile failed: %u\n", GetLastError());
+    SetFilePointer(file, 0, NULL, FILE_BEGIN);
+
+    memcpy(expect, head, 4);
+    memcpy(expect + 4, data, sizeof(data));
+    memcpy(expect + 4 + sizeof(data), tail, 4);
+
+    buffers.Head = head;
+    buffers.HeadLength = 4;
+    buffers.Tail = tail;
+    buffers.TailLength = 4;
+    bret = pTransmitFile(src, file, 0, 0, NULL, &buffers, 0);
+    ok(bret, "TransmitFile failed: %d\n", WSAGetLastError());
+    check_transmitted_data(dst, expect, sizeof(expect));
+
+    /* overlapped, with an event */
+    event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    memset(&ov, 0, sizeof(ov));
+    ov.hEvent = event;
+    bret = pTransmitFile(src, file, 0, 0, &ov, &buffers, 0);
+    ok(bret || WSAGetLastError() == ERROR_IO_PENDING, "TransmitFile failed: %d\n", WSAGetLastError());
+    ret = WaitForSingleObject(event, 1000);
+    ok(ret == WAIT_OBJECT_0, "wait failed: %d\n", ret);
+    bytes = 0xdeadbeef;
+    bret = GetOverlappedResult((HANDLE)src, &ov, &bytes, FALSE);
+    ok(bret, "GetOverlappedResult failed: %u\n", GetLastError());
+    ok(bytes == sizeof(expect), "got %u bytes\n", bytes);
+    check_transmitted_data(dst, expect, sizeof(expect));
+
+    /* overlapped, with a completion port */
+    port = CreateIoCompletionPort((HANDLE)src, NULL, 125, 0);
+    ok(port != NULL, "CreateIoCompletionPort failed: %u\n", GetLastError());
+    memset(&ov, 0, sizeof(ov));
+    bret = pTransmitFile(src, file, 0, 0, &ov, &buffers, 0);
+    ok(bret || WSAGetLastError() == ERROR_IO_PENDING, "TransmitFile failed: %d\n", WSAGetLastError());
+    key = 0xdeadbeef;
+    bytes = 0xdeadbeef;
+    ovp = NULL;
+    bret = GetQueuedCompletionStatus(port, &bytes, &key, &ovp, 1000);
+    ok(bret, "GetQueuedCompletionStatus failed: %u\n", GetLastError());
+    ok(key == 125, "got key %lx\n", key);
+    ok(bytes == sizeof(expect), "got %u bytes\n", bytes);
+    ok(ovp == &ov, "got overlapped %p\n", ovp);
+    check_transmitted_data(dst, expect, sizeof(expect));
+
+    /* TransmitPackets with memory and file elements */
+    ret = WSAIoctl(src, SIO_GET_EXTENSION_FUNCTION_POINTER, &transmitPacketsGuid, sizeof(transmitPacketsGuid),
+                   &pTransmitPackets, sizeof(pTransmitPackets), &written, NULL, NULL);
+    ok(!ret, "WSAIoctl failed: %d\n", WSAGetLastError());
+    if (pTransmitPackets)
+    {
+        memset(elements, 0, sizeof(elements));
+        elements[0].dwElFlags = TP_ELEMENT_MEMORY;
+        elements[0].cLength = 4;
+        elements[0].pBuffer = head;
+        elements[1].dwElFlags = TP_ELEMENT_FILE;
+        elements[1].cLength = 0;
+        elements[1].nFileOffset.QuadPart = 0;
+        elements[1].hFile = file;
+        elements[2].dwElFlags = TP_ELEMENT_MEMORY;
+        elements[2].cLength = 4;
+        elements[2].pBuffer = tail;
+
+        bret = pTransmitPackets(src, elements, 3, 0, NULL, 0);
+        ok(bret, "TransmitPackets failed: %d\n", WSAGetLastError());
+        check_transmitted_data(dst, expect, sizeof(expect));
+
+        memset(&ov, 0, sizeof(ov));
+        bret = pTransmitPackets(src, elements, 3, 1000, &ov, 0);
+        ok(bret || WSAGetLastError() == ERROR_IO_PENDING, "TransmitPackets failed: %d\n", WSAGetLastError());
+        bytes = 0xdeadbeef;
+        ovp = NULL;
+        bret = GetQueuedCompletionStatus(port, &bytes, &key, &ovp, 1000);
+        ok(bret, "GetQueuedCompletionStatus failed: %u\n", GetLastError());
+        ok(bytes == sizeof(expect), "got %u bytes\n", bytes);
+        ok(ovp == &ov, "got overlapped %p\n", ovp);
+        check_transmitted_data(dst, expect, sizeof(expect));
+    }
+    else win_skip("TransmitPackets not available\n");
+
+    CloseHandle(port);
+    CloseHandle(event);
+    CloseHandle(file);
+
+end:
+    if (src != INVALID_SOCKET) closesocket(src);
+    if (dst != INVALID_SOCKET) closesocket(dst);
+}
+
 typedef struct async_message
 {
     SOCKET socket;
@@ -7742,6 +7886,7 @@ START_TEST( sock )
 
     /* this is an io heavy test, do it at the end so the kernel doesn't start dropping packets */
     test_send();
+    test_TransmitFile();
     test_synchronous_WSAIoctl();
 
     Exit();
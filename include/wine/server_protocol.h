@@ -385,6 +385,24 @@ struct object_attributes
 
 };
 
+
+struct fast_sync_slot
+{
+    int          value;
+    int          waiters;
+};
+#define FAST_SYNC_SERVER  (-1)
+
+
+typedef struct
+{
+    apc_param_t   ckey;
+    apc_param_t   cvalue;
+    apc_param_t   information;
+    unsigned int  status;
+    int           __pad;
+} completion_msg_t;
+
 struct token_groups
 {
     unsigned int count;
@@ -1093,6 +1111,20 @@ struct select_reply
 
 
 
+struct init_fast_sync_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+    unsigned int count;
+    char __pad_20[4];
+};
+struct init_fast_sync_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct create_event_request
 {
     struct request_header __header;
@@ -1100,14 +1132,14 @@ struct create_event_request
     unsigned int attributes;
     int          manual_reset;
     int          initial_state;
+    int          fast_slot;
     /* VARARG(objattr,object_attributes); */
-    char __pad_28[4];
 };
 struct create_event_reply
 {
     struct reply_header __header;
     obj_handle_t handle;
-    char __pad_12[4];
+    int          fast;
 };
 
 
@@ -1242,14 +1274,14 @@ struct create_semaphore_request
     unsigned int attributes;
     unsigned int initial;
     unsigned int max;
+    int          fast_slot;
     /* VARARG(objattr,object_attributes); */
-    char __pad_28[4];
 };
 struct create_semaphore_reply
 {
     struct reply_header __header;
     obj_handle_t handle;
-    char __pad_12[4];
+    int          fast;
 };
 
 
@@ -2106,6 +2138,38 @@ struct get_mapping_info_reply
 
 
 
+struct get_mapping_reloc_cache_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_mapping_reloc_cache_reply
+{
+    struct reply_header __header;
+    client_ptr_t base;
+    obj_handle_t cache;
+    char __pad_20[4];
+};
+
+
+
+struct create_mapping_reloc_cache_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+    client_ptr_t base;
+    unsigned int offset;
+    unsigned int end;
+    /* VARARG(data,bytes); */
+};
+struct create_mapping_reloc_cache_reply
+{
+    struct reply_header __header;
+};
+#define RELOC_CACHE_MAX_CHUNK  0x100000
+
+
+
 struct get_mapping_committed_range_request
 {
     struct request_header __header;
@@ -4894,6 +4958,19 @@ struct remove_completion_reply
 
 
 
+struct remove_completions_request
+{
+    struct request_header __header;
+    obj_handle_t  handle;
+};
+struct remove_completions_reply
+{
+    struct reply_header __header;
+    /* VARARG(msgs,completion_msgs); */
+};
+
+
+
 struct query_completion_request
 {
     struct request_header __header;
@@ -5095,6 +5172,7 @@ enum request
     REQ_open_process,
     REQ_open_thread,
     REQ_select,
+    REQ_init_fast_sync,
     REQ_create_event,
     REQ_event_op,
     REQ_query_event,
@@ -5150,6 +5228,8 @@ enum request
     REQ_create_mapping,
     REQ_open_mapping,
     REQ_get_mapping_info,
+    REQ_get_mapping_reloc_cache,
+    REQ_create_mapping_reloc_cache,
     REQ_get_mapping_committed_range,
     REQ_add_mapping_committed_range,
     REQ_create_snapshot,
@@ -5314,6 +5394,7 @@ enum request
     REQ_open_completion,
     REQ_add_completion,
     REQ_remove_completion,
+    REQ_remove_completions,
     REQ_query_completion,
     REQ_set_completion_info,
     REQ_add_fd_completion,
@@ -5357,6 +5438,7 @@ union generic_request
     struct open_process_request open_process_request;
     struct open_thread_request open_thread_request;
     struct select_request select_request;
+    struct init_fast_sync_request init_fast_sync_request;
     struct create_event_request create_event_request;
     struct event_op_request event_op_request;
     struct query_event_request query_event_request;
@@ -5412,6 +5494,8 @@ union generic_request
     struct create_mapping_request create_mapping_request;
     struct open_mapping_request open_mapping_request;
     struct get_mapping_info_request get_mapping_info_request;
+    struct get_mapping_reloc_cache_request get_mapping_reloc_cache_request;
+    struct create_mapping_reloc_cache_request create_mapping_reloc_cache_request;
     struct get_mapping_committed_range_request get_mapping_committed_range_request;
     struct add_mapping_committed_range_request add_mapping_committed_range_request;
     struct create_snapshot_request create_snapshot_request;
@@ -5576,6 +5660,7 @@ union generic_request
     struct open_completion_request open_completion_request;
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
+    struct remove_completions_request remove_completions_request;
     struct query_completion_request query_completion_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
@@ -5617,6 +5702,7 @@ union generic_reply
     struct open_process_reply open_process_reply;
     struct open_thread_reply open_thread_reply;
     struct select_reply select_reply;
+    struct init_fast_sync_reply init_fast_sync_reply;
     struct create_event_reply create_event_reply;
     struct event_op_reply event_op_reply;
     struct query_event_reply query_event_reply;
@@ -5672,6 +5758,8 @@ union generic_reply
     struct create_mapping_reply create_mapping_reply;
     struct open_mapping_reply open_mapping_reply;
     struct get_mapping_info_reply get_mapping_info_reply;
+    struct get_mapping_reloc_cache_reply get_mapping_reloc_cache_reply;
+    struct create_mapping_reloc_cache_reply create_mapping_reloc_cache_reply;
     struct get_mapping_committed_range_reply get_mapping_committed_range_reply;
     struct add_mapping_committed_range_reply add_mapping_committed_range_reply;
     struct create_snapshot_reply create_snapshot_reply;
@@ -5836,6 +5924,7 @@ union generic_reply
     struct open_completion_reply open_completion_reply;
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
+    struct remove_completions_reply remove_completions_reply;
     struct query_completion_reply query_completion_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
@@ -5849,6 +5938,6 @@ union generic_reply
     struct set_suspend_context_reply set_suspend_context_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 457
+#define SERVER_PROTOCOL_VERSION 460
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -53,6 +53,7 @@ struct completion
 
 static void completion_dump( struct object*, int );
 static struct object_type *completion_get_type( struct object *obj );
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry );
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int completion_map_access( struct object *obj, unsigned int access );
 static void completion_destroy( struct object * );
@@ -62,7 +63,7 @@ static const struct object_ops completion_ops =
     sizeof(struct completion), /* size */
     completion_dump,           /* dump */
     completion_get_type,       /* get_type */
-    add_queue,                 /* add_queue */
+    completion_add_queue,      /* add_queue */
     remove_queue,              /* remove_queue */
     completion_signaled,       /* signaled */
     no_satisfied,              /* satisfied */
@@ -114,6 +115,15 @@ static struct object_type *completion_get_type( struct object *obj )
     return get_object_type( &str );
 }
 
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    /* waiters are woken up in LIFO order, so that the most recently active thread runs next */
+    grab_object( obj );
+    entry->obj = obj;
+    list_add_head( &obj->wait_queue, &entry->entry );
+    return 1;
+}
+
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct completion *completion = (struct completion *)obj;
@@ -253,6 +263,41 @@ DECL_HANDLER(remove_completion)
     release_object( completion );
 }
 
+/* get multiple completions from completion port */
+DECL_HANDLER(remove_completions)
+{
+    struct completion* completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+    struct list *entry;
+    struct comp_msg *msg;
+    completion_msg_t *data;
+    data_size_t count;
+
+    if (!completion) return;
+
+    count = min( get_reply_max_size() / sizeof(*data), completion->depth );
+    if (!count)
+        set_error( STATUS_PENDING );
+    else if ((data = set_reply_data_size( count * sizeof(*data) )))
+    {
+        while (count--)
+        {
+            entry = list_head( &completion->queue );
+            list_remove( entry );
+            completion->depth--;
+            msg = LIST_ENTRY( entry, struct comp_msg, queue_entry );
+            data->ckey = msg->ckey;
+            data->cvalue = msg->cvalue;
+            data->information = msg->information;
+            data->status = msg->status;
+            data->__pad = 0;
+            data++;
+            free( msg );
+        }
+    }
+
+    release_object( completion );
+}
+
 /* get queue depth for completion port */
 DECL_HANDLER(query_completion)
 {
@@ -33,6 +33,7 @@
 
 #include "handle.h"
 #include "thread.h"
+#include "process.h"
 #include "request.h"
 #include "security.h"
 
@@ -41,21 +42,24 @@ struct event
     struct object  obj;             /* object header */
     int            manual_reset;    /* is it a manual reset event? */
     int            signaled;        /* event has been signaled */
+    struct fast_sync_slot *fast;    /* client-side state, until the server takes it over */
 };
 
 static void event_dump( struct object *obj, int verbose );
 static struct object_type *event_get_type( struct object *obj );
+static int event_add_queue( struct object *obj, struct wait_queue_entry *entry );
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int event_map_access( struct object *obj, unsigned int access );
 static int event_signal( struct object *obj, unsigned int access);
+static int event_close_handle( struct object *obj, struct process *process, obj_handle_t handle );
 
 static const struct object_ops event_ops =
 {
     sizeof(struct event),      /* size */
     event_dump,                /* dump */
     event_get_type,            /* get_type */
-    add_queue,                 /* add_queue */
+    event_add_queue,           /* add_queue */
     remove_queue,              /* remove_queue */
     event_signaled,            /* signaled */
     event_satisfied,           /* satisfied */
@@ -66,7 +70,7 @@ static const struct object_ops event_ops =
     default_set_sd,            /* set_sd */
     no_lookup_name,            /* lookup_name */
     no_open_file,              /* open_file */
-    no_close_handle,           /* close_handle */
+    event_close_handle,        /* close_handle */
     no_destroy                 /* destroy */
 };
 
@@ -115,6 +119,7 @@ struct event *create_event( struct directory *root, const struct unicode_str *na
             /* initialize it if it didn't already exist */
             event->manual_reset = manual_reset;
             event->signaled     = initial_state;
+            event->fast         = NULL;
             if (sd) default_set_sd( &event->obj, sd, OWNER_SECURITY_INFORMATION|
                                                      GROUP_SECURITY_INFORMATION|
                                                      DACL_SECURITY_INFORMATION|
@@ -124,9 +129,20 @@ struct event *create_event( struct directory *root, const struct unicode_str *na
     return event;
 }
 
+/* take over the state of an event that was managed by the client so far */
+static void event_release_fast_sync( struct event *event )
+{
+    if (!event->fast) return;
+    event->signaled = (release_fast_sync_slot( event->fast ) > 0);
+    event->fast = NULL;
+}
+
 struct event *get_event_obj( struct process *process, obj_handle_t handle, unsigned int access )
 {
-    return (struct event *)get_handle_obj( process, handle, access, &event_ops );
+    struct event *event = (struct event *)get_handle_obj( process, handle, access, &event_ops );
+
+    if (event) event_release_fast_sync( event );
+    return event;
 }
 
 void pulse_event( struct event *event )
@@ -153,8 +169,8 @@ static void event_dump( struct object *obj, int verbose )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
-    fprintf( stderr, "Event manual=%d signaled=%d ",
-             event->manual_reset, event->signaled );
+    fprintf( stderr, "Event manual=%d signaled=%d fast=%p ",
+             event->manual_reset, event->signaled, event->fast );
     dump_object_name( &event->obj );
     fputc( '\n', stderr );
 }
@@ -166,10 +182,19 @@ static struct object_type *event_get_type( struct object *obj )
     return get_object_type( &str );
 }
 
+static int event_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    event_release_fast_sync( event );
+    return add_queue( obj, entry );
+}
+
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
+    event_release_fast_sync( event );
     return event->signaled;
 }
 
@@ -200,10 +225,20 @@ static int event_signal( struct object *obj, unsigned int access )
         set_error( STATUS_ACCESS_DENIED );
         return 0;
     }
+    event_release_fast_sync( event );
     set_event( event );
     return 1;
 }
 
+static int event_close_handle( struct object *obj, struct process *process, obj_handle_t handle )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    /* the client frees the slot once the handle is closed */
+    event_release_fast_sync( event );
+    return 1;
+}
+
 struct keyed_event *create_keyed_event( struct directory *root, const struct unicode_str *name,
                                         unsigned int attr, const struct security_descriptor *sd )
 {
@@ -306,7 +341,12 @@ DECL_HANDLER(create_event)
         if (get_error() == STATUS_OBJECT_NAME_EXISTS)
             reply->handle = alloc_handle( current->process, event, req->access, req->attributes );
         else
+        {
             reply->handle = alloc_handle_no_access_check( current->process, event, req->access, req->attributes );
+            /* the client keeps the state of unnamed events until the server needs it */
+            if (reply->handle && !name.len)
+                reply->fast = (event->fast = get_fast_sync_slot( current->process, req->fast_slot )) != NULL;
+        }
         release_object( event );
     }
 
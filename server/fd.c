@@ -186,6 +186,7 @@ struct fd
     unsigned int         signaled :1; /* is the fd signaled? */
     unsigned int         fs_locks :1; /* can we use filesystem locks for this fd? */
     int                  poll_index;  /* index of fd in poll array */
+    int                  epoll_events;/* events currently registered with epoll */
     struct async_queue  *read_q;      /* async readers of this fd */
     struct async_queue  *write_q;     /* async writers of this fd */
     struct async_queue  *wait_q;      /* other async waiters of this fd */
@@ -262,7 +263,7 @@ struct inode
     struct device      *device;     /* device containing this inode */
     ino_t               ino;        /* inode number */
     struct list         open;       /* list of open file descriptors */
-    struct list         locks;      /* list of file locks */
+    struct file_lock   *locks;      /* tree of file locks, ordered by start offset */
     struct list         closed;     /* list of file descriptors to close at destroy time */
 };
 
@@ -296,7 +297,10 @@ struct file_lock
     struct object       obj;         /* object header */
     struct fd          *fd;          /* fd owning this lock */
     struct list         fd_entry;    /* entry in list of locks on a given fd */
-    struct list         inode_entry; /* entry in inode list of locks */
+    struct file_lock   *left;        /* children in the inode tree of locks */
+    struct file_lock   *right;
+    unsigned int        priority;    /* random priority to keep the tree balanced */
+    file_pos_t          max_end;     /* highest end offset in this subtree */
     int                 shared;      /* shared lock? */
     file_pos_t          start;       /* locked region is interval [start;end) */
     file_pos_t          end;
@@ -347,13 +351,18 @@ static file_pos_t max_unix_offset = OFF_T_MAX;
 
 struct timeout_user
 {
-    struct list           entry;      /* entry in sorted timeout list */
+    struct list           entry;      /* entry in expired timeouts list */
+    unsigned int          index;      /* index in the timeouts heap, TIMEOUT_EXPIRED once removed */
     timeout_t             when;       /* timeout expiry (absolute time) */
     timeout_callback      callback;   /* callback function */
     void                 *private;    /* callback private data */
 };
 
-static struct list timeout_list = LIST_INIT(timeout_list);   /* sorted timeouts list */
+#define TIMEOUT_EXPIRED (~0u)
+
+static struct timeout_user **timeout_heap;   /* binary min-heap of pending timeouts */
+static unsigned int timeout_count;           /* number of timeouts in the heap */
+static unsigned int timeout_size;            /* allocated size of the heap */
 timeout_t current_time;
 
 static inline void set_current_time(void)
@@ -364,32 +373,97 @@ static inline void set_current_time(void)
     current_time = (timeout_t)now.tv_sec * TICKS_PER_SEC + now.tv_usec * 10 + ticks_1601_to_1970;
 }
 
+/* store a timeout at a given position in the heap */
+static inline void set_timeout_heap_entry( unsigned int index, struct timeout_user *user )
+{
+    timeout_heap[index] = user;
+    user->index = index;
+}
+
+/* move a timeout towards the top of the heap until the heap order is restored */
+static void timeout_heap_up( struct timeout_user *user )
+{
+    unsigned int index = user->index;
+
+    while (index)
+    {
+        unsigned int parent = (index - 1) / 2;
+        if (timeout_heap[parent]->when <= user->when) break;
+        set_timeout_heap_entry( index, timeout_heap[parent] );
+        index = parent;
+    }
+    set_timeout_heap_entry( index, user );
+}
+
+/* move a timeout towards the bottom of the heap until the heap order is restored */
+static void timeout_heap_down( struct timeout_user *user )
+{
+    unsigned int index = user->index;
+
+    for (;;)
+    {
+        unsigned int child = 2 * index + 1;
+
+        if (child >= timeout_count) break;
+        if (child + 1 < timeout_count && timeout_heap[child + 1]->when < timeout_heap[child]->when)
+            child++;
+        if (user->when <= timeout_heap[child]->when) break;
+        set_timeout_heap_entry( index, timeout_heap[child] );
+        index = child;
+    }
+    set_timeout_heap_entry( index, user );
+}
+
+/* remove a timeout from the heap */
+static void timeout_heap_remove( struct timeout_user *user )
+{
+    struct timeout_user *last = timeout_heap[--timeout_count];
+
+    if (last != user)
+    {
+        set_timeout_heap_entry( user->index, last );
+        if (last->when < user->when) timeout_heap_up( last );
+        else timeout_heap_down( last );
+    }
+    user->index = TIMEOUT_EXPIRED;
+}
+
 /* add a timeout user */
 struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
 {
     struct timeout_user *user;
-    struct list *ptr;
+
+    if (timeout_count == timeout_size)
+    {
+        unsigned int new_size = max( 64, timeout_size * 2 );
+        struct timeout_user **new_heap = realloc( timeout_heap, new_size * sizeof(*new_heap) );
+
+        if (!new_heap)
+        {
+            set_error( STATUS_NO_MEMORY );
+            return NULL;
+        }
+        timeout_heap = new_heap;
+        timeout_size = new_size;
+    }
 
     if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
     user->when     = (when > 0) ? when : current_time - when;
     user->callback = func;
     user->private  = private;
 
-    /* Now insert it in the linked list */
+    /* Now insert it in the heap */
 
-    LIST_FOR_EACH( ptr, &timeout_list )
-    {
-        struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-        if (timeout->when >= user->when) break;
-    }
-    list_add_before( ptr, &user->entry );
+    set_timeout_heap_entry( timeout_count++, user );
+    timeout_heap_up( user );
     return user;
 }
 
 /* remove a timeout user */
 void remove_timeout_user( struct timeout_user *user )
 {
-    list_remove( &user->entry );
+    if (user->index != TIMEOUT_EXPIRED) timeout_heap_remove( user );
+    else list_remove( &user->entry );  /* expired but callback not called yet */
     free( user );
 }
 
@@ -455,10 +529,29 @@ static inline void init_epoll(void)
     epoll_fd = epoll_create( 128 );
 }
 
+static void epoll_ctl_fd( struct fd *fd, int user, int ctl, int events )
+{
+    struct epoll_event ev;
+
+    ev.events = events;
+    memset(&ev.data, 0, sizeof(ev.data));
+    ev.data.u32 = user;
+
+    if (epoll_ctl( epoll_fd, ctl, fd->unix_fd, &ev ) == -1)
+    {
+        if (errno == ENOMEM)  /* not enough memory, give up on epoll */
+        {
+            close( epoll_fd );
+            epoll_fd = -1;
+        }
+        else perror( "epoll_ctl" );  /* should not happen */
+    }
+    else fd->epoll_events = events;
+}
+
 /* set the events that epoll waits for on this fd; helper for set_fd_events */
 static inline void set_fd_epoll_events( struct fd *fd, int user, int events )
 {
-    struct epoll_event ev;
     int ctl;
 
     if (epoll_fd == -1) return;
@@ -475,23 +568,13 @@ static inline void set_fd_epoll_events( struct fd *fd, int user, int events )
     }
     else
     {
-        if (pollfd[user].events == events) return;  /* nothing to do */
+        /* don't bother removing events from the registration until they actually
+         * occur, most of them get requested again before that happens */
+        if (!(events & ~fd->epoll_events)) return;
         ctl = EPOLL_CTL_MOD;
     }
 
-    ev.events = events;
-    memset(&ev.data, 0, sizeof(ev.data));
-    ev.data.u32 = user;
-
-    if (epoll_ctl( epoll_fd, ctl, fd->unix_fd, &ev ) == -1)
-    {
-        if (errno == ENOMEM)  /* not enough memory, give up on epoll */
-        {
-            close( epoll_fd );
-            epoll_fd = -1;
-        }
-        else perror( "epoll_ctl" );  /* should not happen */
-    }
+    epoll_ctl_fd( fd, user, ctl, events );
 }
 
 static inline void remove_epoll_user( struct fd *fd, int user )
@@ -508,7 +591,7 @@ static inline void remove_epoll_user( struct fd *fd, int user )
 static inline void main_loop_epoll(void)
 {
     int i, ret, timeout;
-    struct epoll_event events[128];
+    struct epoll_event events[512];
 
     assert( POLLIN == EPOLLIN );
     assert( POLLOUT == EPOLLOUT );
@@ -531,7 +614,12 @@ static inline void main_loop_epoll(void)
         for (i = 0; i < ret; i++)
         {
             int user = events[i].data.u32;
-            pollfd[user].revents = events[i].events;
+            int wanted = pollfd[user].events | POLLERR | POLLHUP;
+
+            /* drop the events that are no longer wanted from the registration */
+            if ((events[i].events & ~wanted) && epoll_fd != -1)
+                epoll_ctl_fd( poll_users[user], user, EPOLL_CTL_MOD, pollfd[user].events );
+            pollfd[user].revents = events[i].events & wanted;
         }
 
         /* read events from the pollfd array, as set_fd_events may modify them */
@@ -835,23 +923,19 @@ static void remove_poll_user( struct fd *fd, int user )
 /* process pending timeouts and return the time until the next timeout, in milliseconds */
 static int get_next_timeout(void)
 {
-    if (!list_empty( &timeout_list ))
+    if (timeout_count)
     {
         struct list expired_list, *ptr;
 
-        /* first remove all expired timers from the list */
+        /* first remove all expired timers from the heap */
 
         list_init( &expired_list );
-        while ((ptr = list_head( &timeout_list )) != NULL)
+        while (timeout_count && timeout_heap[0]->when <= current_time)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = timeout_heap[0];
 
-            if (timeout->when <= current_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            timeout_heap_remove( timeout );
+            list_add_tail( &expired_list, &timeout->entry );
         }
 
         /* now call the callback for all the removed timers */
@@ -864,9 +948,9 @@ static int get_next_timeout(void)
             free( timeout );
         }
 
-        if ((ptr = list_head( &timeout_list )) != NULL)
+        if (timeout_count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = timeout_heap[0];
             int diff = (timeout->when - current_time + 9999) / 10000;
             if (diff < 0) diff = 0;
             return diff;
@@ -1039,7 +1123,7 @@ static void inode_destroy( struct object *obj )
     struct list *ptr;
 
     assert( list_empty(&inode->open) );
-    assert( list_empty(&inode->locks) );
+    assert( !inode->locks );
 
     list_remove( &inode->entry );
 
@@ -1087,7 +1171,7 @@ static struct inode *get_inode( dev_t dev, ino_t ino, int unix_fd )
         inode->device = device;
         inode->ino    = ino;
         list_init( &inode->open );
-        list_init( &inode->locks );
+        inode->locks  = NULL;
         list_init( &inode->closed );
         list_add_head( &device->inode_hash[hash], &inode->entry );
     }
@@ -1099,7 +1183,7 @@ static struct inode *get_inode( dev_t dev, ino_t ino, int unix_fd )
 /* add fd to the inode list of file descriptors to close */
 static void inode_add_closed_fd( struct inode *inode, struct closed_fd *fd )
 {
-    if (!list_empty( &inode->locks ))
+    if (inode->locks)
     {
         list_add_head( &inode->closed, &fd->entry );
     }
@@ -1211,104 +1295,158 @@ static inline int lock_overlaps( struct file_lock *lock, file_pos_t start, file_
     return 1;
 }
 
-/* remove Unix locks for all bytes in the specified area that are no longer locked */
-static void remove_unix_locks( struct fd *fd, file_pos_t start, file_pos_t end )
+/* the inode locks are stored in a treap ordered by start offset, where each node also */
+/* records the highest end offset of its subtree, so that overlapping locks can be found */
+/* without looking at all the locks of the inode */
+
+/* end offset of a lock for the purpose of the tree, 0 meaning the end of the file */
+static inline file_pos_t get_lock_end( const struct file_lock *lock )
 {
-    struct hole
-    {
-        struct hole *next;
-        struct hole *prev;
-        file_pos_t   start;
-        file_pos_t   end;
-    } *first, *cur, *next, *buffer;
+    return lock->end ? lock->end : FILE_POS_T_MAX;
+}
 
-    struct list *ptr;
-    int count = 0;
+static inline int compare_locks( const struct file_lock *lock1, const struct file_lock *lock2 )
+{
+    if (lock1->start != lock2->start) return lock1->start < lock2->start ? -1 : 1;
+    if (lock1 != lock2) return lock1 < lock2 ? -1 : 1;
+    return 0;
+}
 
-    if (!fd->inode) return;
-    if (!fd->fs_locks) return;
-    if (start == end || start > max_unix_offset) return;
-    if (!end || end > max_unix_offset) end = max_unix_offset + 1;
+/* recompute the highest end offset of a subtree after its children changed */
+static inline void update_lock_node( struct file_lock *lock )
+{
+    lock->max_end = get_lock_end( lock );
+    if (lock->left && lock->left->max_end > lock->max_end) lock->max_end = lock->left->max_end;
+    if (lock->right && lock->right->max_end > lock->max_end) lock->max_end = lock->right->max_end;
+}
 
-    /* count the number of locks overlapping the specified area */
+static struct file_lock *insert_lock_node( struct file_lock *root, struct file_lock *lock )
+{
+    struct file_lock *child;
 
-    LIST_FOR_EACH( ptr, &fd->inode->locks )
+    if (!root) return lock;
+    if (compare_locks( lock, root ) < 0)
     {
-        struct file_lock *lock = LIST_ENTRY( ptr, struct file_lock, inode_entry );
-        if (lock->start == lock->end) continue;
-        if (lock_overlaps( lock, start, end )) count++;
+        child = root->left = insert_lock_node( root->left, lock );
+        if (child->priority > root->priority)  /* rotate right */
+        {
+            root->left = child->right;
+            child->right = root;
+            update_lock_node( root );
+            root = child;
+        }
+    }
+    else
+    {
+        child = root->right = insert_lock_node( root->right, lock );
+        if (child->priority > root->priority)  /* rotate left */
+        {
+            root->right = child->left;
+            child->left = root;
+            update_lock_node( root );
+            root = child;
+        }
     }
+    update_lock_node( root );
+    return root;
+}
 
-    if (!count)  /* no locks at all, we can unlock everything */
+static struct file_lock *merge_lock_nodes( struct file_lock *left, struct file_lock *right )
+{
+    if (!left) return right;
+    if (!right) return left;
+    if (left->priority > right->priority)
     {
-        set_unix_lock( fd, start, end, F_UNLCK );
-        return;
+        left->right = merge_lock_nodes( left->right, right );
+        update_lock_node( left );
+        return left;
     }
+    right->left = merge_lock_nodes( left, right->left );
+    update_lock_node( right );
+    return right;
+}
 
-    /* allocate space for the list of holes */
-    /* max. number of holes is number of locks + 1 */
+static struct file_lock *remove_lock_node( struct file_lock *root, struct file_lock *lock )
+{
+    int cmp = compare_locks( lock, root );
 
-    if (!(buffer = malloc( sizeof(*buffer) * (count+1) ))) return;
-    first = buffer;
-    first->next  = NULL;
-    first->prev  = NULL;
-    first->start = start;
-    first->end   = end;
-    next = first + 1;
+    if (!cmp) return merge_lock_nodes( root->left, root->right );
+    if (cmp < 0) root->left = remove_lock_node( root->left, lock );
+    else root->right = remove_lock_node( root->right, lock );
+    update_lock_node( root );
+    return root;
+}
 
-    /* build a sorted list of unlocked holes in the specified area */
+/* call func for all the locks overlapping [start;end) in order of start offset, */
+/* until it returns non-zero; return the last value returned by func */
+static int enum_overlapping_locks( struct file_lock *lock, file_pos_t start, file_pos_t end,
+                                   int (*func)( struct file_lock *lock, void *arg ), void *arg )
+{
+    int ret;
 
-    LIST_FOR_EACH( ptr, &fd->inode->locks )
+    while (lock)
     {
-        struct file_lock *lock = LIST_ENTRY( ptr, struct file_lock, inode_entry );
-        if (lock->start == lock->end) continue;
-        if (!lock_overlaps( lock, start, end )) continue;
+        /* no lock in this subtree ends after start */
+        if (lock->max_end <= start && lock->max_end != FILE_POS_T_MAX) return 0;
+        if ((ret = enum_overlapping_locks( lock->left, start, end, func, arg ))) return ret;
+        /* this lock and the right subtree start after end */
+        if (end && lock->start >= end) return 0;
+        if (lock_overlaps( lock, start, end ) && (ret = func( lock, arg ))) return ret;
+        lock = lock->right;
+    }
+    return 0;
+}
 
-        /* go through all the holes touched by this lock */
-        for (cur = first; cur; cur = cur->next)
-        {
-            if (cur->end <= lock->start) continue; /* hole is before start of lock */
-            if (lock->end && cur->start >= lock->end) break;  /* hole is after end of lock */
+struct unlock_holes_info
+{
+    struct fd  *fd;      /* fd to unlock */
+    file_pos_t  pos;     /* start of the area not known to be locked yet */
+    file_pos_t  end;     /* end of the area to unlock */
+};
 
-            /* now we know that lock is overlapping hole */
+/* enum_overlapping_locks callback: remove the Unix lock in front of a lock */
+static int unlock_hole( struct file_lock *lock, void *arg )
+{
+    struct unlock_holes_info *info = arg;
 
-            if (cur->start >= lock->start)  /* lock starts before hole, shrink from start */
-            {
-                cur->start = lock->end;
-                if (cur->start && cur->start < cur->end) break;  /* done with this lock */
-                /* now hole is empty, remove it */
-                if (cur->next) cur->next->prev = cur->prev;
-                if (cur->prev) cur->prev->next = cur->next;
-                else if (!(first = cur->next)) goto done;  /* no more holes at all */
-            }
-            else if (!lock->end || cur->end <= lock->end)  /* lock larger than hole, shrink from end */
-            {
-                cur->end = lock->start;
-                assert( cur->start < cur->end );
-            }
-            else  /* lock is in the middle of hole, split hole in two */
-            {
-                next->prev = cur;
-                next->next = cur->next;
-                cur->next = next;
-                next->start = lock->end;
-                next->end = cur->end;
-                cur->end = lock->start;
-                assert( next->start < next->end );
-                assert( cur->end < next->start );
-                next++;
-                break;  /* done with this lock */
-            }
-        }
+    if (lock->start == lock->end) return 0;
+    if (lock->start > info->pos) set_unix_lock( info->fd, info->pos, lock->start, F_UNLCK );
+    if (!lock->end || lock->end >= info->end)  /* locked up to the end */
+    {
+        info->pos = info->end;
+        return 1;
     }
+    if (lock->end > info->pos) info->pos = lock->end;
+    return 0;
+}
 
-    /* clear Unix locks for all the holes */
+/* remove Unix locks for all bytes in the specified area that are no longer locked */
+static void remove_unix_locks( struct fd *fd, file_pos_t start, file_pos_t end )
+{
+    struct unlock_holes_info info;
 
-    for (cur = first; cur; cur = cur->next)
-        set_unix_lock( fd, cur->start, cur->end, F_UNLCK );
+    if (!fd->inode) return;
+    if (!fd->fs_locks) return;
+    if (start == end || start > max_unix_offset) return;
+    if (!end || end > max_unix_offset) end = max_unix_offset + 1;
 
- done:
-    free( buffer );
+    /* go through the locks in order, unlocking the holes between them */
+    info.fd  = fd;
+    info.pos = start;
+    info.end = end;
+    enum_overlapping_locks( fd->inode->locks, start, end, unlock_hole, &info );
+    if (info.pos < end) set_unix_lock( fd, info.pos, end, F_UNLCK );
+}
+
+/* return a random priority for a new lock */
+static unsigned int get_lock_priority(void)
+{
+    static unsigned int seed = 0x12345678;
+
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
 }
 
 /* create a new lock on a fd */
@@ -1329,8 +1467,12 @@ static struct file_lock *add_lock( struct fd *fd, int shared, file_pos_t start,
         release_object( lock );
         return NULL;
     }
+    lock->left     = NULL;
+    lock->right    = NULL;
+    lock->priority = get_lock_priority();
+    lock->max_end  = get_lock_end( lock );
     list_add_tail( &fd->locks, &lock->fd_entry );
-    list_add_tail( &fd->inode->locks, &lock->inode_entry );
+    fd->inode->locks = insert_lock_node( fd->inode->locks, lock );
     list_add_tail( &lock->process->locks, &lock->proc_entry );
     return lock;
 }
@@ -1341,10 +1483,10 @@ static void remove_lock( struct file_lock *lock, int remove_unix )
     struct inode *inode = lock->fd->inode;
 
     list_remove( &lock->fd_entry );
-    list_remove( &lock->inode_entry );
+    inode->locks = remove_lock_node( inode->locks, lock );
     list_remove( &lock->proc_entry );
     if (remove_unix) remove_unix_locks( lock->fd, lock->start, lock->end );
-    if (list_empty( &inode->locks )) inode_close_pending( inode, 1 );
+    if (!inode->locks) inode_close_pending( inode, 1 );
     lock->process = NULL;
     wake_up( &lock->obj, 0 );
     release_object( lock );
@@ -1378,11 +1520,41 @@ static void remove_fd_locks( struct fd *fd )
     if (start < end) remove_unix_locks( fd, start, end + 1 );
 }
 
+struct lock_search_info
+{
+    struct fd        *fd;       /* fd requesting the lock */
+    int               shared;   /* is it a shared lock? */
+    file_pos_t        start;    /* requested area */
+    file_pos_t        end;
+    struct file_lock *lock;     /* lock found */
+};
+
+/* enum_overlapping_locks callback: check if a lock conflicts with the requested one */
+static int find_lock_conflict( struct file_lock *lock, void *arg )
+{
+    struct lock_search_info *info = arg;
+
+    if (info->shared && (lock->shared || lock->fd == info->fd)) return 0;
+    info->lock = lock;
+    return 1;
+}
+
+/* enum_overlapping_locks callback: check if a lock matches the requested one exactly */
+static int find_exact_lock( struct file_lock *lock, void *arg )
+{
+    struct lock_search_info *info = arg;
+
+    if (lock->start > info->start) return -1;  /* no match possible anymore */
+    if (lock->start != info->start || lock->end != info->end || lock->fd != info->fd) return 0;
+    info->lock = lock;
+    return 1;
+}
+
 /* add a lock on an fd */
 /* returns handle to wait on */
 obj_handle_t lock_fd( struct fd *fd, file_pos_t start, file_pos_t count, int shared, int wait )
 {
-    struct list *ptr;
+    struct lock_search_info info;
     file_pos_t end = start + count;
 
     if (!fd->inode)  /* not a regular file */
@@ -1399,19 +1571,17 @@ obj_handle_t lock_fd( struct fd *fd, file_pos_t start, file_pos_t count, int sha
     }
 
     /* check if another lock on that file overlaps the area */
-    LIST_FOR_EACH( ptr, &fd->inode->locks )
+    info.fd     = fd;
+    info.shared = shared;
+    if (enum_overlapping_locks( fd->inode->locks, start, end, find_lock_conflict, &info ))
     {
-        struct file_lock *lock = LIST_ENTRY( ptr, struct file_lock, inode_entry );
-        if (!lock_overlaps( lock, start, end )) continue;
-        if (shared && (lock->shared || lock->fd == fd)) continue;
-        /* found one */
         if (!wait)
         {
             set_error( STATUS_FILE_LOCK_CONFLICT );
             return 0;
         }
         set_error( STATUS_PENDING );
-        return alloc_handle( current->process, lock, SYNCHRONIZE, 0 );
+        return alloc_handle( current->process, info.lock, SYNCHRONIZE, 0 );
     }
 
     /* not found, add it */
@@ -1427,10 +1597,22 @@ obj_handle_t lock_fd( struct fd *fd, file_pos_t start, file_pos_t count, int sha
 /* remove a lock on an fd */
 void unlock_fd( struct fd *fd, file_pos_t start, file_pos_t count )
 {
+    struct lock_search_info info;
     struct list *ptr;
     file_pos_t end = start + count;
 
     /* find an existing lock with the exact same parameters */
+    if (fd->inode && start != end)  /* an empty lock doesn't overlap its own range */
+    {
+        info.fd    = fd;
+        info.start = start;
+        info.end   = end;
+        if (enum_overlapping_locks( fd->inode->locks, start, end, find_exact_lock, &info ) == 1)
+            remove_lock( info.lock, 1 );
+        else
+            set_error( STATUS_FILE_LOCK_CONFLICT );
+        return;
+    }
     LIST_FOR_EACH( ptr, &fd->locks )
     {
         struct file_lock *lock = LIST_ENTRY( ptr, struct file_lock, fd_entry );
@@ -1589,6 +1771,7 @@ static struct fd *alloc_fd_object(void)
     fd->signaled   = 1;
     fd->fs_locks   = 1;
     fd->poll_index = -1;
+    fd->epoll_events = 0;
     fd->read_q     = NULL;
     fd->write_q    = NULL;
     fd->wait_q     = NULL;
@@ -1624,6 +1807,7 @@ struct fd *alloc_pseudo_fd( const struct fd_ops *fd_user_ops, struct object *use
     fd->signaled   = 0;
     fd->fs_locks   = 0;
     fd->poll_index = -1;
+    fd->epoll_events = 0;
     fd->read_q     = NULL;
     fd->write_q    = NULL;
     fd->wait_q     = NULL;
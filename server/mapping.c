@@ -67,6 +67,14 @@ struct mapping
     struct ranges  *committed;       /* list of committed ranges in this mapping */
     struct file    *shared_file;     /* temp file for shared PE mapping */
     struct list     shared_entry;    /* entry in global shared PE mappings list */
+    unsigned int    checksum;        /* header checksum (for PE image mapping) */
+    unsigned int    timestamp;       /* header time stamp (for PE image mapping) */
+    file_pos_t      file_size;       /* file size at the time of the mapping (for PE image mapping) */
+    time_t          file_mtime;      /* file modification time (for PE image mapping) */
+    struct mapping *reloc;           /* anonymous mapping with the relocated PE image contents */
+    client_ptr_t    reloc_base;      /* base address the cached PE image contents are relocated to */
+    mem_size_t      reloc_next;      /* offset of the next chunk while the contents are being created */
+    struct list     reloc_entry;     /* entry in global relocated PE mappings list */
 };
 
 static void mapping_dump( struct object *obj, int verbose );
@@ -109,6 +117,7 @@ static const struct fd_ops mapping_fd_ops =
 };
 
 static struct list shared_list = LIST_INIT(shared_list);
+static struct list reloc_list = LIST_INIT(reloc_list);
 
 static size_t page_mask;
 
@@ -205,6 +214,44 @@ static struct file *get_shared_file( struct mapping *mapping )
     return NULL;
 }
 
+/* check whether two PE mappings are for the same version of the same file */
+static int is_same_image( const struct mapping *mapping1, const struct mapping *mapping2 )
+{
+    /* the file may have been modified in place since the other mapping was created */
+    return (mapping1->cpu == mapping2->cpu &&
+            mapping1->size == mapping2->size &&
+            mapping1->base == mapping2->base &&
+            mapping1->header_size == mapping2->header_size &&
+            mapping1->checksum == mapping2->checksum &&
+            mapping1->timestamp == mapping2->timestamp &&
+            mapping1->file_size == mapping2->file_size &&
+            mapping1->file_mtime == mapping2->file_mtime &&
+            is_same_file_fd( mapping1->fd, mapping2->fd ));
+}
+
+/* find the cached relocated contents for a given PE mapping */
+static struct mapping *get_reloc_mapping( struct mapping *mapping )
+{
+    struct mapping *ptr;
+
+    if (mapping->reloc && !mapping->reloc_next) return mapping->reloc;
+
+    /* only complete caches are on the list */
+    LIST_FOR_EACH_ENTRY( ptr, &reloc_list, struct mapping, reloc_entry )
+    {
+        if (!is_same_image( ptr, mapping )) continue;
+        /* drop our own cache if another process completed one first */
+        if (mapping->reloc) release_object( mapping->reloc );
+        /* keep the cache alive as long as one of the mappings is */
+        mapping->reloc = (struct mapping *)grab_object( ptr->reloc );
+        mapping->reloc_base = ptr->reloc_base;
+        mapping->reloc_next = 0;
+        list_add_head( &reloc_list, &mapping->reloc_entry );
+        return mapping->reloc;
+    }
+    return NULL;
+}
+
 /* return the size of the memory mapping and file range of a given section */
 static inline void get_section_sizes( const IMAGE_SECTION_HEADER *sec, size_t *map_size,
                                       off_t *file_start, size_t *file_size )
@@ -382,6 +429,7 @@ static unsigned int get_image_params( struct mapping *mapping, int unix_fd, int
             IMAGE_OPTIONAL_HEADER64 hdr64;
         } opt;
     } nt;
+    struct stat st;
     off_t pos;
     int size;
 
@@ -436,13 +484,20 @@ static unsigned int get_image_params( struct mapping *mapping, int unix_fd, int
         mapping->size        = ROUND_SIZE( nt.opt.hdr32.SizeOfImage );
         mapping->base        = nt.opt.hdr32.ImageBase;
         mapping->header_size = nt.opt.hdr32.SizeOfHeaders;
+        mapping->checksum    = nt.opt.hdr32.CheckSum;
         break;
     case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
         mapping->size        = ROUND_SIZE( nt.opt.hdr64.SizeOfImage );
         mapping->base        = nt.opt.hdr64.ImageBase;
         mapping->header_size = nt.opt.hdr64.SizeOfHeaders;
+        mapping->checksum    = nt.opt.hdr64.CheckSum;
         break;
     }
+    mapping->timestamp = nt.FileHeader.TimeDateStamp;
+
+    if (fstat( unix_fd, &st ) == -1) return STATUS_INVALID_FILE_FOR_SECTION;
+    mapping->file_size  = st.st_size;
+    mapping->file_mtime = st.st_mtime;
 
     /* load the section headers */
 
@@ -493,6 +548,9 @@ static struct object *create_mapping( struct directory *root, const struct unico
     mapping->fd          = NULL;
     mapping->shared_file = NULL;
     mapping->committed   = NULL;
+    mapping->reloc       = NULL;
+    mapping->reloc_base  = 0;
+    mapping->reloc_next  = 0;
 
     if (protect & VPROT_READ) access |= FILE_READ_DATA;
     if (protect & VPROT_WRITE) access |= FILE_WRITE_DATA;
@@ -642,6 +700,11 @@ static void mapping_destroy( struct object *obj )
         release_object( mapping->shared_file );
         list_remove( &mapping->shared_entry );
     }
+    if (mapping->reloc)
+    {
+        release_object( mapping->reloc );
+        if (!mapping->reloc_next) list_remove( &mapping->reloc_entry );
+    }
     free( mapping->committed );
 }
 
@@ -744,6 +807,77 @@ DECL_HANDLER(get_mapping_info)
     release_object( mapping );
 }
 
+/* get the cached relocated contents of an image mapping */
+DECL_HANDLER(get_mapping_reloc_cache)
+{
+    struct mapping *mapping, *reloc;
+
+    if (!(mapping = get_mapping_obj( current->process, req->handle, 0 ))) return;
+
+    if (!(mapping->protect & VPROT_IMAGE) || mapping->cpu != current->process->cpu)
+        set_error( STATUS_INVALID_PARAMETER );
+    else if ((reloc = get_reloc_mapping( mapping )))
+    {
+        reply->base  = mapping->reloc_base;
+        reply->cache = alloc_handle( current->process, reloc, SECTION_MAP_READ, 0 );
+    }
+    release_object( mapping );
+}
+
+/* add a chunk to the cache of relocated contents for an image mapping */
+DECL_HANDLER(create_mapping_reloc_cache)
+{
+    struct mapping *mapping;
+    data_size_t size = get_req_data_size();
+
+    if (!(mapping = get_mapping_obj( current->process, req->handle, 0 ))) return;
+
+    if (!(mapping->protect & VPROT_IMAGE) || mapping->cpu != current->process->cpu ||
+        !req->base || (req->base & page_mask) || req->end > mapping->size ||
+        !req->offset || req->offset >= req->end || size > req->end - req->offset || size > RELOC_CACHE_MAX_CHUNK)
+        set_error( STATUS_INVALID_PARAMETER );
+    else if (get_reloc_mapping( mapping ))  /* the first one wins */
+        set_error( STATUS_ALREADY_COMMITTED );
+    else if (!mapping->reloc)
+    {
+        /* the contents are only ever written here, clients can only map them copy-on-write */
+        if ((mapping->reloc = (struct mapping *)create_mapping( NULL, NULL, 0, mapping->size,
+                                                                VPROT_COMMITTED | VPROT_READ, 0, NULL )))
+        {
+            mapping->reloc_base = req->base;
+            mapping->reloc_next = req->offset;
+        }
+    }
+    else if (req->base != mapping->reloc_base || req->offset != mapping->reloc_next)
+    {
+        /* a new attempt, start over */
+        release_object( mapping->reloc );
+        mapping->reloc = NULL;
+        set_error( STATUS_INVALID_PARAMETER );
+    }
+
+    if (mapping->reloc && mapping->reloc_next && !get_error())
+    {
+        if (pwrite( get_unix_fd( mapping->reloc->fd ), get_req_data(), size, req->offset ) == size)
+        {
+            mapping->reloc_next += size;
+            if (mapping->reloc_next == req->end)
+            {
+                /* complete, let other processes use it */
+                mapping->reloc_next = 0;
+                list_add_head( &reloc_list, &mapping->reloc_entry );
+            }
+        }
+        else
+        {
+            file_set_error();
+            release_object( mapping->reloc );
+            mapping->reloc = NULL;
+        }
+    }
+    release_object( mapping );
+}
+
 /* get a range of committed pages in a file mapping */
 DECL_HANDLER(get_mapping_committed_range)
 {
@@ -45,6 +45,7 @@ struct object_name
     struct list         entry;           /* entry in the hash list */
     struct object      *obj;             /* object owning this name */
     struct object      *parent;          /* parent object */
+    struct namespace   *namespace;       /* namespace containing this name */
     data_size_t         len;             /* name length in bytes */
     WCHAR               name[1];
 };
@@ -52,13 +53,40 @@ struct object_name
 struct namespace
 {
     unsigned int        hash_size;       /* size of hash table */
-    struct list         names[1];        /* array of hash entry lists */
+    unsigned int        count;           /* number of names in the table */
+    struct list        *names;           /* array of hash entry lists */
+#ifdef DEBUG_OBJECTS
+    struct list         entry;           /* entry in the namespace list */
+#endif
 };
 
 
 #ifdef DEBUG_OBJECTS
 static struct list object_list = LIST_INIT(object_list);
 static struct list static_object_list = LIST_INIT(static_object_list);
+static struct list namespace_list = LIST_INIT(namespace_list);
+
+static void dump_namespaces(void)
+{
+    struct namespace *namespace;
+    struct list *p;
+    unsigned int i, len, used, longest;
+
+    LIST_FOR_EACH_ENTRY( namespace, &namespace_list, struct namespace, entry )
+    {
+        used = longest = 0;
+        for (i = 0; i < namespace->hash_size; i++)
+        {
+            if (list_empty( &namespace->names[i] )) continue;
+            used++;
+            len = 0;
+            LIST_FOR_EACH( p, &namespace->names[i] ) len++;
+            if (len > longest) longest = len;
+        }
+        fprintf( stderr, "namespace %p: %u names, %u/%u buckets used, longest chain %u\n",
+                 namespace, namespace->count, used, namespace->hash_size, longest );
+    }
+}
 
 void dump_objects(void)
 {
@@ -76,6 +104,7 @@ void dump_objects(void)
         fprintf( stderr, "%p:%d: ", ptr, ptr->refcount );
         ptr->ops->dump( ptr, 1 );
     }
+    dump_namespaces();
 }
 
 void close_objects(void)
@@ -120,14 +149,37 @@ void *memdup( const void *data, size_t len )
 
 /*****************************************************************/
 
-static int get_name_hash( const struct namespace *namespace, const WCHAR *name, data_size_t len )
+static unsigned int get_name_hash( const struct namespace *namespace, const WCHAR *name, data_size_t len )
 {
-    WCHAR hash = 0;
+    unsigned int hash = 0;
     len /= sizeof(WCHAR);
-    while (len--) hash ^= tolowerW(*name++);
+    while (len--) hash = hash * 31 + tolowerW(*name++);
     return hash % namespace->hash_size;
 }
 
+/* grow the hash table once it gets too crowded */
+static void grow_namespace( struct namespace *namespace )
+{
+    struct list *names, *old_names = namespace->names;
+    unsigned int i, old_size = namespace->hash_size, hash_size = old_size * 4 + 1;
+    struct object_name *ptr, *next;
+
+    if (!(names = malloc( hash_size * sizeof(*names) ))) return;  /* keep the old table */
+    for (i = 0; i < hash_size; i++) list_init( &names[i] );
+
+    namespace->names = names;
+    namespace->hash_size = hash_size;
+    for (i = 0; i < old_size; i++)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE( ptr, next, &old_names[i], struct object_name, entry )
+        {
+            list_remove( &ptr->entry );
+            list_add_tail( &names[get_name_hash( namespace, ptr->name, ptr->len )], &ptr->entry );
+        }
+    }
+    free( old_names );
+}
+
 /* allocate a name for an object */
 static struct object_name *alloc_name( const struct unicode_str *name )
 {
@@ -147,6 +199,7 @@ static void free_name( struct object *obj )
 {
     struct object_name *ptr = obj->name;
     list_remove( &ptr->entry );
+    ptr->namespace->count--;
     if (ptr->parent) release_object( ptr->parent );
     free( ptr );
 }
@@ -155,9 +208,10 @@ static void free_name( struct object *obj )
 static void set_object_name( struct namespace *namespace,
                              struct object *obj, struct object_name *ptr )
 {
-    int hash = get_name_hash( namespace, ptr->name, ptr->len );
-
-    list_add_head( &namespace->names[hash], &ptr->entry );
+    if (namespace->count >= 2 * namespace->hash_size) grow_namespace( namespace );
+    list_add_head( &namespace->names[get_name_hash( namespace, ptr->name, ptr->len )], &ptr->entry );
+    namespace->count++;
+    ptr->namespace = namespace;
     ptr->obj = obj;
     obj->name = ptr;
 }
@@ -352,6 +406,11 @@ struct object *find_object_index( const struct namespace *namespace, unsigned in
 {
     unsigned int i;
 
+    if (index >= namespace->count)
+    {
+        set_error( STATUS_NO_MORE_ENTRIES );
+        return NULL;
+    }
     /* FIXME: not efficient at all */
     for (i = 0; i < namespace->hash_size; i++)
     {
@@ -371,15 +430,32 @@ struct namespace *create_namespace( unsigned int hash_size )
     struct namespace *namespace;
     unsigned int i;
 
-    namespace = mem_alloc( sizeof(*namespace) + (hash_size - 1) * sizeof(namespace->names[0]) );
-    if (namespace)
+    if (!(namespace = mem_alloc( sizeof(*namespace) ))) return NULL;
+    if (!(namespace->names = mem_alloc( hash_size * sizeof(namespace->names[0]) )))
     {
-        namespace->hash_size      = hash_size;
-        for (i = 0; i < hash_size; i++) list_init( &namespace->names[i] );
+        free( namespace );
+        return NULL;
     }
+    namespace->hash_size = hash_size;
+    namespace->count     = 0;
+    for (i = 0; i < hash_size; i++) list_init( &namespace->names[i] );
+#ifdef DEBUG_OBJECTS
+    list_add_tail( &namespace_list, &namespace->entry );
+#endif
     return namespace;
 }
 
+/* free a namespace */
+void free_namespace( struct namespace *namespace )
+{
+    if (!namespace) return;
+#ifdef DEBUG_OBJECTS
+    list_remove( &namespace->entry );
+#endif
+    free( namespace->names );
+    free( namespace );
+}
+
 /* functions for unimplemented/default object operations */
 
 struct object_type *no_get_type( struct object *obj )
@@ -124,6 +124,7 @@ extern void *create_named_object( struct namespace *namespace, const struct obje
 extern void unlink_named_object( struct object *obj );
 extern void make_object_static( struct object *obj );
 extern struct namespace *create_namespace( unsigned int hash_size );
+extern void free_namespace( struct namespace *namespace );
 /* grab/release_object can take any pointer, but you better make sure */
 /* that the thing pointed to starts with a struct object... */
 extern struct object *grab_object( void *obj );
@@ -230,6 +231,7 @@ extern void create_mailslot_device( struct directory *root, const struct unicode
   /* command-line options */
 extern int debug_level;
 extern int foreground;
+extern int request_stats;
 extern timeout_t master_socket_timeout;
 extern const char *server_argv0;
 
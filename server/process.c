@@ -28,7 +28,14 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
 #ifdef HAVE_SYS_SOCKET_H
 # include <sys/socket.h>
 #endif
@@ -336,6 +343,8 @@ struct thread *create_process( int fd, struct thread *parent_thread, int inherit
     process->trace_data      = 0;
     process->rawinput_mouse  = NULL;
     process->rawinput_kbd    = NULL;
+    process->fast_sync       = NULL;
+    process->fast_sync_count = 0;
     list_init( &process->thread_list );
     list_init( &process->locks );
     list_init( &process->classes );
@@ -421,6 +430,7 @@ static void process_destroy( struct object *obj )
     assert( !process->sigkill_timeout );  /* timeout should hold a reference to the process */
 
     close_process_handles( process );
+    if (process->fast_sync) munmap( process->fast_sync, process->fast_sync_count * sizeof(*process->fast_sync) );
     set_process_startup_state( process, STARTUP_ABORTED );
     if (process->console) release_object( process->console );
     if (process->parent) release_object( process->parent );
@@ -832,6 +842,24 @@ void enum_processes( int (*cb)(struct process*, void*), void *user )
     }
 }
 
+/* get the fast sync slot that a new object of the process should use, if any */
+struct fast_sync_slot *get_fast_sync_slot( struct process *process, int index )
+{
+    if (index < 0 || (unsigned int)index >= process->fast_sync_count) return NULL;
+    return &process->fast_sync[index];
+}
+
+/* take over the state of a fast sync object and wake the client threads waiting on it */
+/* return the last value set by the client */
+int release_fast_sync_slot( struct fast_sync_slot *slot )
+{
+    int value = interlocked_xchg( &slot->value, FAST_SYNC_SERVER );
+#ifdef __linux__
+    syscall( __NR_futex, &slot->value, 1 /* FUTEX_WAKE */, INT_MAX, NULL, 0, 0 );
+#endif
+    return value;
+}
+
 /* set the debugged flag in the process PEB */
 int set_process_debug_flag( struct process *process, int flag )
 {
@@ -1293,3 +1321,44 @@ DECL_HANDLER(make_process_system)
             shutdown_timeout = add_timeout_user( master_socket_timeout, server_shutdown_timeout, NULL );
     }
 }
+
+/* set the shared memory holding the state of the fast synchronization objects */
+DECL_HANDLER(init_fast_sync)
+{
+#if defined(__linux__) && defined(HAVE_SYS_MMAN_H)
+    struct process *process = current->process;
+    struct mapping *mapping;
+    struct stat st;
+    struct fd *fd;
+    void *ptr;
+    int unix_fd;
+
+    if (process->fast_sync || !req->count || req->count > 0x100000)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+    if (!(mapping = get_mapping_obj( process, req->handle, SECTION_MAP_READ | SECTION_MAP_WRITE ))) return;
+    if ((fd = get_obj_fd( (struct object *)mapping )))
+    {
+        if ((unix_fd = get_unix_fd( fd )) != -1)
+        {
+            if (fstat( unix_fd, &st ) == -1) file_set_error();
+            else if (st.st_size < req->count * sizeof(*process->fast_sync))
+                set_error( STATUS_INVALID_PARAMETER );
+            else if ((ptr = mmap( NULL, req->count * sizeof(*process->fast_sync), PROT_READ | PROT_WRITE,
+                                  MAP_SHARED, unix_fd, 0 )) == MAP_FAILED)
+                file_set_error();
+            else
+            {
+                process->fast_sync = ptr;
+                process->fast_sync_count = req->count;
+            }
+        }
+        release_object( fd );
+    }
+    release_object( mapping );
+#else
+    set_error( STATUS_NOT_SUPPORTED );
+#endif
+}
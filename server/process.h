@@ -91,6 +91,8 @@ struct process
     struct list          rawinput_devices;/* list of registered rawinput devices */
     const struct rawinput_device *rawinput_mouse; /* rawinput mouse device, if any */
     const struct rawinput_device *rawinput_kbd;   /* rawinput keyboard device, if any */
+    struct fast_sync_slot *fast_sync;     /* shared state of the fast synchronization objects */
+    unsigned int         fast_sync_count; /* number of fast sync slots */
 };
 
 struct process_snapshot
@@ -133,6 +135,8 @@ extern void break_process( struct process *process );
 extern void detach_debugged_processes( struct thread *debugger );
 extern struct process_snapshot *process_snap( int *count );
 extern void enum_processes( int (*cb)(struct process*, void*), void *user);
+extern struct fast_sync_slot *get_fast_sync_slot( struct process *process, int index );
+extern int release_fast_sync_slot( struct fast_sync_slot *slot );
 
 /* console functions */
 extern void inherit_console(struct thread *parent_thread, struct process *process, obj_handle_t hconin);
@@ -46,6 +46,9 @@
 #ifdef HAVE_SYS_THR_H
 # include <sys/thr.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif
 #include <unistd.h>
 
 #include "ntstatus.h"
@@ -328,21 +331,56 @@ static struct thread *get_ptrace_thread( struct process *process )
     return NULL;
 }
 
+#if defined(__linux__) && defined(__NR_process_vm_readv) && defined(__NR_process_vm_writev)
+
+/* copy data from/to a process memory space without having to stop it */
+/* returns 0 if the caller should fall back to ptrace */
+static int copy_process_vm( struct process *process, client_ptr_t ptr, data_size_t size, void *data, int do_write )
+{
+    static int disabled;
+    struct iovec local, remote;
+    long ret;
+
+    if (disabled || process->unix_pid == -1) return 0;
+
+    local.iov_base = data;
+    local.iov_len = size;
+    remote.iov_base = (void *)(unsigned long)ptr;
+    remote.iov_len = size;
+
+    ret = syscall( do_write ? __NR_process_vm_writev : __NR_process_vm_readv,
+                   process->unix_pid, &local, 1, &remote, 1, 0 );
+    if (ret == size) return 1;
+    if (ret == -1 && errno == ENOSYS) disabled = 1;
+    /* let the ptrace path handle partial copies and permission errors */
+    return 0;
+}
+
+#else
+
+static int copy_process_vm( struct process *process, client_ptr_t ptr, data_size_t size, void *data, int do_write )
+{
+    return 0;
+}
+
+#endif
+
 /* read data from a process memory space */
 int read_process_memory( struct process *process, client_ptr_t ptr, data_size_t size, char *dest )
 {
-    struct thread *thread = get_ptrace_thread( process );
+    struct thread *thread;
     unsigned int first_offset, last_offset, len;
     long data, *addr;
 
-    if (!thread) return 0;
-
     if ((unsigned long)ptr != ptr)
     {
         set_error( STATUS_ACCESS_DENIED );
         return 0;
     }
 
+    if (!(thread = get_ptrace_thread( process ))) return 0;
+    if (copy_process_vm( process, ptr, size, dest, 0 )) return 1;
+
     first_offset = ptr % sizeof(long);
     last_offset = (size + first_offset) % sizeof(long);
     if (!last_offset) last_offset = sizeof(long);
@@ -416,21 +454,22 @@ static int check_process_write_access( struct thread *thread, long *addr, data_s
 /* write data to a process memory space */
 int write_process_memory( struct process *process, client_ptr_t ptr, data_size_t size, const char *src )
 {
-    struct thread *thread = get_ptrace_thread( process );
+    struct thread *thread;
     int ret = 0;
     long data = 0;
     data_size_t len;
     long *addr;
     unsigned long first_mask, first_offset, last_mask, last_offset;
 
-    if (!thread) return 0;
-
     if ((unsigned long)ptr != ptr)
     {
         set_error( STATUS_ACCESS_DENIED );
         return 0;
     }
 
+    if (!(thread = get_ptrace_thread( process ))) return 0;
+    if (copy_process_vm( process, ptr, size, (void *)src, 1 )) return 1;
+
     /* compute the mask for the first long */
     first_mask = ~0;
     first_offset = ptr % sizeof(long);
@@ -50,6 +50,8 @@
 enum message_kind { SEND_MESSAGE, POST_MESSAGE };
 #define NB_MSG_KINDS (POST_MESSAGE+1)
 
+#define POSTED_HASH_SIZE 32  /* number of buckets for posted message lookups by message code */
+
 
 struct message_result
 {
@@ -72,6 +74,8 @@ struct message_result
 struct message
 {
     struct list            entry;     /* entry in message list */
+    struct list            hash_entry; /* entry in posted message hash */
+    unsigned int           seq;       /* sequence number for posted messages */
     enum message_type      type;      /* message type */
     user_handle_t          win;       /* window handle */
     unsigned int           msg;       /* message code */
@@ -111,6 +115,7 @@ struct thread_input
     user_handle_t          cursor;        /* current cursor */
     int                    cursor_count;  /* cursor show count */
     struct list            msg_list;      /* list of hardware messages */
+    unsigned int           merged_count;  /* number of mouse moves merged into a queued message */
     unsigned char          keystate[256]; /* state of each key */
 };
 
@@ -128,6 +133,8 @@ struct msg_queue
     int                    exit_code;       /* exit code of pending quit message */
     int                    cursor_count;    /* per-queue cursor show count */
     struct list            msg_list[NB_MSG_KINDS];  /* lists of messages */
+    struct list            posted_hash[POSTED_HASH_SIZE];  /* posted messages by message code */
+    unsigned int           posted_seq;      /* sequence number for the next posted message */
     struct list            send_result;     /* stack of sent messages waiting for result */
     struct list            callback_result; /* list of callback messages waiting for result */
     struct message_result *recv_result;     /* stack of received messages waiting for result */
@@ -249,6 +256,7 @@ static struct thread_input *create_thread_input( struct thread *thread )
         input->move_size    = 0;
         input->cursor       = 0;
         input->cursor_count = 0;
+        input->merged_count = 0;
         list_init( &input->msg_list );
         set_caret_window( input, 0 );
         memset( input->keystate, 0, sizeof(input->keystate) );
@@ -297,6 +305,8 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         list_init( &queue->pending_timers );
         list_init( &queue->expired_timers );
         for (i = 0; i < NB_MSG_KINDS; i++) list_init( &queue->msg_list[i] );
+        for (i = 0; i < POSTED_HASH_SIZE; i++) list_init( &queue->posted_hash[i] );
+        queue->posted_seq      = 0;
 
         thread->queue = queue;
     }
@@ -517,6 +527,7 @@ static int merge_message( struct thread_input *input, const struct message *msg
     }
     list_remove( ptr );
     list_add_tail( &input->msg_list, ptr );
+    input->merged_count++;
     return 1;
 }
 
@@ -599,6 +610,14 @@ static void free_message( struct message *msg )
     free( msg );
 }
 
+/* add a message to the posted messages list of a queue */
+static void add_posted_message( struct msg_queue *queue, struct message *msg )
+{
+    msg->seq = queue->posted_seq++;
+    list_add_tail( &queue->msg_list[POST_MESSAGE], &msg->entry );
+    list_add_tail( &queue->posted_hash[msg->msg % POSTED_HASH_SIZE], &msg->hash_entry );
+}
+
 /* remove (and free) a message from a message list */
 static void remove_queue_message( struct msg_queue *queue, struct message *msg,
                                   enum message_kind kind )
@@ -610,6 +629,7 @@ static void remove_queue_message( struct msg_queue *queue, struct message *msg,
         if (list_empty( &queue->msg_list[kind] )) clear_queue_bits( queue, QS_SENDMESSAGE );
         break;
     case POST_MESSAGE:
+        list_remove( &msg->hash_entry );
         if (list_empty( &queue->msg_list[kind] ) && !queue->quit_message)
             clear_queue_bits( queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
         if (msg->msg == WM_HOTKEY && --queue->hotkey_count == 0)
@@ -765,7 +785,28 @@ static int get_posted_message( struct msg_queue *queue, user_handle_t win,
                                unsigned int first, unsigned int last, unsigned int flags,
                                struct get_message_reply *reply )
 {
-    struct message *msg;
+    struct message *msg, *best = NULL;
+    unsigned int code;
+
+    if (last - first < POSTED_HASH_SIZE)
+    {
+        /* small range, every message code in it has its own bucket */
+        for (code = first; ; code++)
+        {
+            LIST_FOR_EACH_ENTRY( msg, &queue->posted_hash[code % POSTED_HASH_SIZE],
+                                 struct message, hash_entry )
+            {
+                if (msg->msg != code) continue;
+                if (best && (int)(msg->seq - best->seq) > 0) break;
+                if (!match_window( win, msg->win )) continue;
+                best = msg;
+                break;
+            }
+            if (code == last) break;
+        }
+        if (!(msg = best)) return 0;
+        goto found;
+    }
 
     /* check against the filters */
     LIST_FOR_EACH_ENTRY( msg, &queue->msg_list[POST_MESSAGE], struct message, entry )
@@ -989,8 +1030,8 @@ static void msg_queue_poll_event( struct fd *fd, int event )
 static void thread_input_dump( struct object *obj, int verbose )
 {
     struct thread_input *input = (struct thread_input *)obj;
-    fprintf( stderr, "Thread input focus=%08x capture=%08x active=%08x\n",
-             input->focus, input->capture, input->active );
+    fprintf( stderr, "Thread input focus=%08x capture=%08x active=%08x merged=%u\n",
+             input->focus, input->capture, input->active, input->merged_count );
 }
 
 static void thread_input_destroy( struct object *obj )
@@ -1371,7 +1412,7 @@ found:
     msg->data      = NULL;
     msg->data_size = 0;
 
-    list_add_tail( &hotkey->queue->msg_list[POST_MESSAGE], &msg->entry );
+    add_posted_message( hotkey->queue, msg );
     set_queue_bits( hotkey->queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE|QS_HOTKEY );
     hotkey->queue->hotkey_count++;
     return 1;
@@ -2071,7 +2112,7 @@ void post_message( user_handle_t win, unsigned int message, lparam_t wparam, lpa
         msg->data      = NULL;
         msg->data_size = 0;
 
-        list_add_tail( &thread->queue->msg_list[POST_MESSAGE], &msg->entry );
+        add_posted_message( thread->queue, msg );
         set_queue_bits( thread->queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
         if (message == WM_HOTKEY)
         {
@@ -2284,7 +2325,7 @@ DECL_HANDLER(send_message)
             set_queue_bits( recv_queue, QS_SENDMESSAGE );
             break;
         case MSG_POSTED:
-            list_add_tail( &recv_queue->msg_list[POST_MESSAGE], &msg->entry );
+            add_posted_message( recv_queue, msg );
             set_queue_bits( recv_queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
             if (msg->msg == WM_HOTKEY)
             {
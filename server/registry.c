@@ -27,13 +27,21 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
+#ifdef HAVE_SYS_POLL_H
+#include <sys/poll.h>
+#endif
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -72,9 +80,11 @@ struct key
     int               last_subkey; /* last in use subkey */
     int               nb_subkeys;  /* count of allocated subkeys */
     struct key      **subkeys;     /* subkeys array */
+    struct name_index *subkey_index; /* hash index of the subkeys array */
     int               last_value;  /* last in use value */
     int               nb_values;   /* count of allocated values in array */
     struct key_value *values;      /* values array */
+    struct name_index *value_index; /* hash index of the values array */
     unsigned int      flags;       /* flags */
     timeout_t         modif;       /* last modification time */
     struct list       notify_list; /* list of notifications */
@@ -87,6 +97,8 @@ struct key
 #define KEY_SYMLINK  0x0008  /* key is a symbolic link */
 #define KEY_WOW64    0x0010  /* key contains a Wow6432Node subkey */
 #define KEY_WOWSHARE 0x0020  /* key is a Wow64 shared key (used for Software\Classes) */
+#define KEY_UNSORTED_SUBKEYS 0x0040  /* indexed subkeys array needs to be sorted */
+#define KEY_UNSORTED_VALUES  0x0080  /* indexed values array needs to be sorted */
 
 /* a key value */
 struct key_value
@@ -100,6 +112,22 @@ struct key_value
 
 #define MIN_SUBKEYS  8   /* min. number of allocated subkeys per key */
 #define MIN_VALUES   8   /* min. number of allocated values per key */
+#define MIN_INDEXED 64   /* min. number of subkeys or values for using a hash index */
+
+/* hash index of the subkeys or values of a key
+ *
+ * The subkeys and values arrays are normally kept sorted and searched with
+ * a binary search. Once a key has many entries, lookups go through a hash
+ * index instead, new entries are simply appended and the array is only
+ * sorted again when something depends on the order (enumeration, saving).
+ */
+struct name_index
+{
+    unsigned int      size;        /* number of buckets, a power of 2 */
+    int               buckets[1];  /* array indices, -1 for an empty bucket */
+};
+
+typedef const WCHAR *(*get_entry_name_func)( const struct key *key, int index, data_size_t *len );
 
 #define MAX_NAME_LEN  255    /* max. length of a key name */
 #define MAX_VALUE_LEN 16383  /* max. length of a value name */
@@ -110,6 +138,7 @@ static struct key *root_key;
 static const timeout_t ticks_1601_to_1970 = (timeout_t)86400 * (369 * 365 + 89) * TICKS_PER_SEC;
 static const timeout_t save_period = 30 * -TICKS_PER_SEC;  /* delay between periodic saves */
 static struct timeout_user *save_timeout_user;  /* saving timer */
+static int save_pipe = -1;  /* pipe to the background saving process */
 static enum prefix_type { PREFIX_UNKNOWN, PREFIX_32BIT, PREFIX_64BIT } prefix_type;
 
 static const WCHAR root_name[] = { '\\','R','e','g','i','s','t','r','y','\\' };
@@ -119,6 +148,8 @@ static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_va
 
 static void set_periodic_save_timer(void);
 static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
+static void sort_subkeys( struct key *key );
+static void sort_values( struct key *key );
 
 /* information about where to save a registry branch */
 struct save_branch_info
@@ -253,11 +284,13 @@ static void dump_value( const struct key_value *value, FILE *f )
 }
 
 /* save a registry and all its subkeys to a text file */
-static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
+static void save_subkeys( struct key *key, const struct key *base, FILE *f )
 {
     int i;
 
     if (key->flags & KEY_VOLATILE) return;
+    sort_subkeys( key );
+    sort_values( key );
     /* save key if it has either some values or no subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
     if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
@@ -407,12 +440,14 @@ static void key_destroy( struct object *obj )
         free( key->values[i].data );
     }
     free( key->values );
+    free( key->value_index );
     for (i = 0; i <= key->last_subkey; i++)
     {
         key->subkeys[i]->parent = NULL;
         release_object( key->subkeys[i] );
     }
     free( key->subkeys );
+    free( key->subkey_index );
     /* unconditionally notify everything waiting on this key */
     while ((ptr = list_head( &key->notify_list )))
     {
@@ -476,9 +511,11 @@ static struct key *alloc_key( const struct unicode_str *name, timeout_t modif )
         key->last_subkey = -1;
         key->nb_subkeys  = 0;
         key->subkeys     = NULL;
+        key->subkey_index = NULL;
         key->nb_values   = 0;
         key->last_value  = -1;
         key->values      = NULL;
+        key->value_index = NULL;
         key->modif       = modif;
         key->parent      = NULL;
         list_init( &key->notify_list );
@@ -540,6 +577,212 @@ static void touch_key( struct key *key, unsigned int change )
         check_notify( k, change & ~REG_NOTIFY_CHANGE_LAST_SET, 0 );
 }
 
+/* compare two subkey or value names, in the order used for the sorted arrays */
+static inline int compare_entry_names( const WCHAR *name1, data_size_t len1,
+                                       const WCHAR *name2, data_size_t len2 )
+{
+    int res = memicmpW( name1, name2, min( len1, len2 ) / sizeof(WCHAR) );
+    if (!res) res = len1 - len2;
+    return res;
+}
+
+/* case-insensitive hash of a subkey or value name */
+static unsigned int hash_entry_name( const WCHAR *name, data_size_t len )
+{
+    unsigned int i, hash = 0;
+
+    for (i = 0; i < len / sizeof(WCHAR); i++) hash = hash * 65599 + tolowerW( name[i] );
+    return hash;
+}
+
+static const WCHAR *get_subkey_name( const struct key *key, int index, data_size_t *len )
+{
+    *len = key->subkeys[index]->namelen;
+    return key->subkeys[index]->name;
+}
+
+static const WCHAR *get_value_name( const struct key *key, int index, data_size_t *len )
+{
+    *len = key->values[index].namelen;
+    return key->values[index].name;
+}
+
+/* return the bucket where a name should be stored in the index */
+static inline unsigned int get_name_bucket( const struct name_index *index, const WCHAR *name,
+                                            data_size_t len )
+{
+    return hash_entry_name( name, len ) & (index->size - 1);
+}
+
+/* add an array entry to the index; there must be a free bucket */
+static void name_index_add( struct name_index *index, const struct key *key, int i,
+                            get_entry_name_func get_name )
+{
+    data_size_t len;
+    const WCHAR *name = get_name( key, i, &len );
+    unsigned int bucket = get_name_bucket( index, name, len );
+
+    while (index->buckets[bucket] != -1) bucket = (bucket + 1) & (index->size - 1);
+    index->buckets[bucket] = i;
+}
+
+/* create the index of the first count entries of the subkeys or values array */
+static struct name_index *create_name_index( const struct key *key, int count,
+                                             get_entry_name_func get_name )
+{
+    struct name_index *index;
+    unsigned int size = 2 * MIN_INDEXED;
+    int i;
+
+    while (size < 2 * count) size *= 2;
+    if (!(index = mem_alloc( offsetof( struct name_index, buckets[size] )))) return NULL;
+    index->size = size;
+    memset( index->buckets, 0xff, size * sizeof(index->buckets[0]) );
+    for (i = 0; i < count; i++) name_index_add( index, key, i, get_name );
+    return index;
+}
+
+/* find a name in the index and return its array index, or -1 if not found */
+static int name_index_find( const struct name_index *index, const struct key *key,
+                            const struct unicode_str *name, get_entry_name_func get_name )
+{
+    unsigned int bucket = get_name_bucket( index, name->str, name->len );
+    int i;
+
+    while ((i = index->buckets[bucket]) != -1)
+    {
+        data_size_t len;
+        const WCHAR *str = get_name( key, i, &len );
+        if (!compare_entry_names( str, len, name->str, name->len )) return i;
+        bucket = (bucket + 1) & (index->size - 1);
+    }
+    return -1;
+}
+
+/* remove an array entry from the index, before it is removed from the array itself */
+static void name_index_remove( struct name_index *index, const struct key *key, int i,
+                               get_entry_name_func get_name )
+{
+    unsigned int mask = index->size - 1;
+    unsigned int hole, next, ideal, bucket;
+    data_size_t len;
+    const WCHAR *name = get_name( key, i, &len );
+
+    for (hole = get_name_bucket( index, name, len ); index->buckets[hole] != i; hole = (hole + 1) & mask)
+        assert( index->buckets[hole] != -1 );
+
+    /* move back the following entries of the probe sequence that can fill the hole */
+    for (next = (hole + 1) & mask; index->buckets[next] != -1; next = (next + 1) & mask)
+    {
+        name = get_name( key, index->buckets[next], &len );
+        ideal = get_name_bucket( index, name, len );
+        if (hole <= next ? (hole < ideal && ideal <= next) : (hole < ideal || ideal <= next))
+            continue;
+        index->buckets[hole] = index->buckets[next];
+        hole = next;
+    }
+    index->buckets[hole] = -1;
+
+    /* the following array entries are going to move down by one */
+    for (bucket = 0; bucket < index->size; bucket++)
+        if (index->buckets[bucket] > i) index->buckets[bucket]--;
+}
+
+/* add the entry that was just appended to the array to the index, growing it if needed */
+static int name_index_append( struct name_index **index, const struct key *key, int count,
+                              get_entry_name_func get_name )
+{
+    if (2 * count > (*index)->size)
+    {
+        struct name_index *new_index;
+
+        if (!(new_index = create_name_index( key, count, get_name ))) return 0;
+        free( *index );
+        *index = new_index;
+    }
+    else name_index_add( *index, key, count - 1, get_name );
+    return 1;
+}
+
+static int compare_subkeys( const void *p1, const void *p2 )
+{
+    const struct key *key1 = *(const struct key * const *)p1;
+    const struct key *key2 = *(const struct key * const *)p2;
+    return compare_entry_names( key1->name, key1->namelen, key2->name, key2->namelen );
+}
+
+static int compare_values( const void *p1, const void *p2 )
+{
+    const struct key_value *value1 = p1;
+    const struct key_value *value2 = p2;
+    return compare_entry_names( value1->name, value1->namelen, value2->name, value2->namelen );
+}
+
+/* restore the order of the subkeys array after entries have been appended to it */
+static void sort_subkeys( struct key *key )
+{
+    if (!(key->flags & KEY_UNSORTED_SUBKEYS)) return;
+    qsort( key->subkeys, key->last_subkey + 1, sizeof(*key->subkeys), compare_subkeys );
+    key->flags &= ~KEY_UNSORTED_SUBKEYS;
+    /* without an index lookups use a binary search, which is fine now that the array is sorted */
+    free( key->subkey_index );
+    key->subkey_index = create_name_index( key, key->last_subkey + 1, get_subkey_name );
+}
+
+/* restore the order of the values array after entries have been appended to it */
+static void sort_values( struct key *key )
+{
+    if (!(key->flags & KEY_UNSORTED_VALUES)) return;
+    qsort( key->values, key->last_value + 1, sizeof(*key->values), compare_values );
+    key->flags &= ~KEY_UNSORTED_VALUES;
+    free( key->value_index );
+    key->value_index = create_name_index( key, key->last_value + 1, get_value_name );
+}
+
+/* update the subkeys index once a subkey has been added; indexed keys append new subkeys */
+static void update_subkey_index( struct key *key )
+{
+    int count = key->last_subkey + 1;
+
+    if (!key->subkey_index)
+    {
+        if (count >= MIN_INDEXED)
+            key->subkey_index = create_name_index( key, count, get_subkey_name );
+        return;
+    }
+    if (count > 1 && compare_subkeys( &key->subkeys[count - 2], &key->subkeys[count - 1] ) > 0)
+        key->flags |= KEY_UNSORTED_SUBKEYS;
+    if (!name_index_append( &key->subkey_index, key, count, get_subkey_name ))
+    {
+        /* fall back to a sorted array without index */
+        sort_subkeys( key );
+        free( key->subkey_index );
+        key->subkey_index = NULL;
+    }
+}
+
+/* update the values index once a value has been added; indexed keys append new values */
+static void update_value_index( struct key *key )
+{
+    int count = key->last_value + 1;
+
+    if (!key->value_index)
+    {
+        if (count >= MIN_INDEXED)
+            key->value_index = create_name_index( key, count, get_value_name );
+        return;
+    }
+    if (count > 1 && compare_values( &key->values[count - 2], &key->values[count - 1] ) > 0)
+        key->flags |= KEY_UNSORTED_VALUES;
+    if (!name_index_append( &key->value_index, key, count, get_value_name ))
+    {
+        /* fall back to a sorted array without index */
+        sort_values( key );
+        free( key->value_index );
+        key->value_index = NULL;
+    }
+}
+
 /* try to grow the array of subkeys; return 1 if OK, 0 on error */
 static int grow_subkeys( struct key *key )
 {
@@ -585,9 +828,11 @@ static struct key *alloc_subkey( struct key *parent, const struct unicode_str *n
     if ((key = alloc_key( name, modif )) != NULL)
     {
         key->parent = parent;
+        if (parent->subkey_index) assert( index == parent->last_subkey + 1 );
         for (i = ++parent->last_subkey; i > index; i--)
             parent->subkeys[i] = parent->subkeys[i-1];
         parent->subkeys[index] = key;
+        update_subkey_index( parent );
         if (is_wow6432node( key->name, key->namelen ) && !is_wow6432node( parent->name, parent->namelen ))
             parent->flags |= KEY_WOW64;
     }
@@ -604,8 +849,15 @@ static void free_subkey( struct key *parent, int index )
     assert( index <= parent->last_subkey );
 
     key = parent->subkeys[index];
+    if (parent->subkey_index) name_index_remove( parent->subkey_index, parent, index, get_subkey_name );
     for (i = index; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
     parent->last_subkey--;
+    if (parent->subkey_index && parent->last_subkey + 1 < MIN_INDEXED / 2)
+    {
+        sort_subkeys( parent );
+        free( parent->subkey_index );
+        parent->subkey_index = NULL;
+    }
     key->flags |= KEY_DELETED;
     key->parent = NULL;
     if (is_wow6432node( key->name, key->namelen )) parent->flags &= ~KEY_WOW64;
@@ -628,16 +880,25 @@ static void free_subkey( struct key *parent, int index )
 static struct key *find_subkey( const struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
-    data_size_t len;
+
+    if (key->subkey_index)
+    {
+        if ((i = name_index_find( key->subkey_index, key, name, get_subkey_name )) != -1)
+        {
+            *index = i;
+            return key->subkeys[i];
+        }
+        *index = key->last_subkey + 1;  /* new subkeys are appended to indexed keys */
+        return NULL;
+    }
 
     min = 0;
     max = key->last_subkey;
     while (min <= max)
     {
         i = (min + max) / 2;
-        len = min( key->subkeys[i]->namelen, name->len );
-        res = memicmpW( key->subkeys[i]->name, name->str, len / sizeof(WCHAR) );
-        if (!res) res = key->subkeys[i]->namelen - name->len;
+        res = compare_entry_names( key->subkeys[i]->name, key->subkeys[i]->namelen,
+                                   name->str, name->len );
         if (!res)
         {
             *index = i;
@@ -861,7 +1122,7 @@ static struct key *create_key_recursive( struct key *key, const struct unicode_s
 }
 
 /* query information about a key or a subkey */
-static void enum_key( const struct key *key, int index, int info_class,
+static void enum_key( struct key *key, int index, int info_class,
                       struct enum_key_reply *reply )
 {
     int i;
@@ -877,6 +1138,7 @@ static void enum_key( const struct key *key, int index, int info_class,
             set_error( STATUS_NO_MORE_ENTRIES );
             return;
         }
+        sort_subkeys( key );
         key = key->subkeys[index];
     }
 
@@ -949,6 +1211,7 @@ static int delete_key( struct key *key, int recurse )
 {
     int index;
     struct key *parent = key->parent;
+    struct unicode_str name;
 
     /* must find parent and index */
     if (key == root_key)
@@ -962,9 +1225,10 @@ static int delete_key( struct key *key, int recurse )
         if (0 > delete_key(key->subkeys[key->last_subkey], 1))
             return -1;
 
-    for (index = 0; index <= parent->last_subkey; index++)
-        if (parent->subkeys[index] == key) break;
-    assert( index <= parent->last_subkey );
+    name.str = key->name;
+    name.len = key->namelen;
+    find_subkey( parent, &name, &index );
+    assert( index <= parent->last_subkey && parent->subkeys[index] == key );
 
     /* we can only delete a key that has no subkeys */
     if (key->last_subkey >= 0)
@@ -1008,16 +1272,25 @@ static int grow_values( struct key *key )
 static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
-    data_size_t len;
+
+    if (key->value_index)
+    {
+        if ((i = name_index_find( key->value_index, key, name, get_value_name )) != -1)
+        {
+            *index = i;
+            return &key->values[i];
+        }
+        *index = key->last_value + 1;  /* new values are appended to indexed keys */
+        return NULL;
+    }
 
     min = 0;
     max = key->last_value;
     while (min <= max)
     {
         i = (min + max) / 2;
-        len = min( key->values[i].namelen, name->len );
-        res = memicmpW( key->values[i].name, name->str, len / sizeof(WCHAR) );
-        if (!res) res = key->values[i].namelen - name->len;
+        res = compare_entry_names( key->values[i].name, key->values[i].namelen,
+                                   name->str, name->len );
         if (!res)
         {
             *index = i;
@@ -1047,12 +1320,14 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
         if (!grow_values( key )) return NULL;
     }
     if (name->len && !(new_name = memdup( name->str, name->len ))) return NULL;
+    if (key->value_index) assert( index == key->last_value + 1 );
     for (i = ++key->last_value; i > index; i--) key->values[i] = key->values[i - 1];
     value = &key->values[index];
     value->name    = new_name;
     value->namelen = name->len;
     value->len     = 0;
     value->data    = NULL;
+    update_value_index( key );
     return value;
 }
 
@@ -1135,6 +1410,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
         void *data;
         data_size_t namelen, maxlen;
 
+        sort_values( key );
         value = &key->values[i];
         reply->type = value->type;
         namelen = value->namelen;
@@ -1187,10 +1463,17 @@ static void delete_value( struct key *key, const struct unicode_str *name )
         return;
     }
     if (debug_level > 1) dump_operation( key, value, "Delete" );
+    if (key->value_index) name_index_remove( key->value_index, key, index, get_value_name );
     free( value->name );
     free( value->data );
     for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
     key->last_value--;
+    if (key->value_index && key->last_value + 1 < MIN_INDEXED / 2)
+    {
+        sort_values( key );
+        free( key->value_index );
+        key->value_index = NULL;
+    }
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
 
     /* try to shrink the array */
@@ -1317,8 +1600,39 @@ static int get_data_type( const char *buffer, int *type, int *parse_type )
     return 0;
 }
 
+/* find the deepest ancestor of the previously loaded key that is also an ancestor of the new key */
+/* keys are usually stored in tree order, so this avoids looking up the whole path again */
+static struct key *find_load_parent( struct key *base, struct key *prev, struct unicode_str *name )
+{
+    struct key *chain[32], *key;
+    struct unicode_str token;
+    int i, depth = 0;
+
+    for (key = prev; key && key != base; key = key->parent)
+    {
+        if (depth == sizeof(chain) / sizeof(chain[0])) return base;
+        chain[depth++] = key;
+    }
+    if (key != base) return base;
+
+    token.str = NULL;
+    if (!get_path_token( name, &token )) return base;
+    for (key = base; depth > 0; key = chain[depth])
+    {
+        depth--;
+        if (!token.len || (chain[depth]->flags & KEY_SYMLINK)) break;
+        if (token.len != chain[depth]->namelen ||
+            memicmpW( token.str, chain[depth]->name, token.len / sizeof(WCHAR) )) break;
+        get_path_token( name, &token );
+    }
+    i = token.str - name->str;
+    name->len -= i * sizeof(WCHAR);
+    name->str += i;
+    return key;
+}
+
 /* load and create a key from the input file */
-static struct key *load_key( struct key *base, const char *buffer,
+static struct key *load_key( struct key *base, struct key *prev, const char *buffer,
                              int prefix_len, struct file_load_info *info )
 {
     WCHAR *p;
@@ -1354,6 +1668,7 @@ static struct key *load_key( struct key *base, const char *buffer,
     }
     name.str = p;
     name.len = len - (p - info->tmp + 1) * sizeof(WCHAR);
+    if (prev) base = find_load_parent( base, prev, &name );
     return create_key_recursive( base, &name, modif );
 }
 
@@ -1413,15 +1728,18 @@ static int parse_hex( unsigned char *dest, data_size_t *len, const char *buffer
 {
     const char *p = buffer;
     data_size_t count = 0;
-    char *end;
 
     while (isxdigit(*p))
     {
-        unsigned int val = strtoul( p, &end, 16 );
-        if (end == p || val > 0xff) return -1;
+        unsigned int val = 0;
+
+        do
+        {
+            val = val * 16 + (*p <= '9' ? *p - '0' : (*p | 0x20) - 'a' + 10);
+            if (val > 0xff) return -1;
+        } while (isxdigit(*++p));
         if (count++ >= *len) return -1;  /* dest buffer overflow */
         *dest++ = val;
-        p = end;
         while (isspace(*p)) p++;
         if (*p == ',') p++;
         while (isspace(*p)) p++;
@@ -1564,7 +1882,7 @@ static int get_prefix_len( struct key *key, const char *name, struct file_load_i
 /* prefix_len is the number of key name prefixes to skip, or -1 for autodetection */
 static void load_keys( struct key *key, const char *filename, FILE *f, int prefix_len )
 {
-    struct key *subkey = NULL;
+    struct key *subkey = NULL, *newkey;
     struct file_load_info info;
     char *p;
 
@@ -1594,10 +1912,10 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
         switch(*p)
         {
         case '[':   /* new key */
-            if (subkey) release_object( subkey );
             if (prefix_len == -1) prefix_len = get_prefix_len( key, p + 1, &info );
-            if (!(subkey = load_key( key, p + 1, prefix_len, &info )))
-                file_read_error( "Error creating key", &info );
+            newkey = load_key( key, subkey, p + 1, prefix_len, &info );
+            if (subkey) release_object( subkey );
+            if (!(subkey = newkey)) file_read_error( "Error creating key", &info );
             break;
         case '@':   /* default value */
         case '\"':  /* value */
@@ -1914,16 +2232,118 @@ done:
     return ret;
 }
 
+/* wait for the background saving process to finish */
+/* return 0 if it's still running after timeout milliseconds */
+static int wait_save_process( int timeout )
+{
+    struct pollfd pfd;
+    char status = 0;
+    int i, ret;
+
+    if (save_pipe == -1) return 1;
+
+    pfd.fd = save_pipe;
+    pfd.events = POLLIN;
+    while ((ret = poll( &pfd, 1, timeout )) == -1 && errno == EINTR);
+    if (!ret) return 0;
+
+    if (read( save_pipe, &status, 1 ) != 1 || !status)
+    {
+        /* something went wrong, make sure everything is saved again */
+        for (i = 0; i < save_branch_count; i++) save_branch_info[i].key->flags |= KEY_DIRTY;
+    }
+    close( save_pipe );
+    save_pipe = -1;
+    return 1;
+}
+
+#ifdef USE_PTRACE
+/* close all the inherited file descriptors except stdio and keep_fd */
+static void close_inherited_fds( int keep_fd )
+{
+    int fd, max_fd;
+#ifdef linux
+    DIR *dir;
+    struct dirent *de;
+
+    /* only walk the fds that are actually open, _SC_OPEN_MAX can be huge */
+    if ((dir = opendir( "/proc/self/fd" )))
+    {
+        int dir_fd = dirfd( dir );
+
+        while ((de = readdir( dir )))
+        {
+            if (de->d_name[0] < '0' || de->d_name[0] > '9') continue;
+            fd = atoi( de->d_name );
+            if (fd >= 3 && fd != keep_fd && fd != dir_fd) close( fd );
+        }
+        closedir( dir );
+        return;
+    }
+#endif
+    if ((max_fd = sysconf( _SC_OPEN_MAX )) == -1) max_fd = 1024;
+    for (fd = 3; fd < max_fd; fd++) if (fd != keep_fd) close( fd );
+}
+#endif
+
+/* save the modified registry branches from a child process, so that the server doesn't block */
+/* return 0 if the child couldn't be started */
+static int start_save_process(void)
+{
+#ifdef USE_PTRACE  /* other tracing mechanisms don't expect the server to have children */
+    static const int signals[] = { SIGCHLD, SIGHUP, SIGINT, SIGALRM, SIGIO, SIGQUIT, SIGTERM, SIGSEGV };
+    int i, fds[2];
+    char status;
+
+    for (i = 0; i < save_branch_count; i++)
+        if (save_branch_info[i].key->flags & KEY_DIRTY) break;
+    if (i == save_branch_count) return 1;  /* nothing to do */
+
+    if (pipe( fds ) == -1) return 0;
+    switch (fork())
+    {
+    case -1:
+        close( fds[0] );
+        close( fds[1] );
+        return 0;
+    case 0:  /* child */
+        for (i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) signal( signals[i], SIG_DFL );
+        /* don't keep the client connections and server objects alive while saving */
+        close_inherited_fds( fds[1] );
+        status = 1;
+        for (i = 0; i < save_branch_count; i++)
+            if (!save_branch( save_branch_info[i].key, save_branch_info[i].path )) status = 0;
+        write( fds[1], &status, 1 );
+        _exit( 0 );
+    default:  /* parent */
+        close( fds[1] );
+        fcntl( fds[0], F_SETFD, FD_CLOEXEC );
+        save_pipe = fds[0];
+        /* the child has its own copy of the tree, anything changed from now on needs another save */
+        for (i = 0; i < save_branch_count; i++) make_clean( save_branch_info[i].key );
+        return 1;
+    }
+#else
+    return 0;
+#endif
+}
+
 /* periodic saving of the registry */
 static void periodic_save( void *arg )
 {
     int i;
 
-    if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
-    for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].path );
-    if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
+    if (wait_save_process( 0 ))
+    {
+        if (fchdir( config_dir_fd ) == -1) return;
+        if (!start_save_process())
+        {
+            for (i = 0; i < save_branch_count; i++)
+                save_branch( save_branch_info[i].key, save_branch_info[i].path );
+        }
+        if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
+    }
     set_periodic_save_timer();
 }
 
@@ -1939,6 +2359,7 @@ void flush_registry(void)
 {
     int i;
 
+    wait_save_process( -1 );
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
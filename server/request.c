@@ -235,6 +235,8 @@ static void call_req_handler( struct thread *thread )
 {
     union generic_reply reply;
     enum request req = thread->req.request_header.req;
+    data_size_t request_size = thread->req.request_header.request_size;
+    unsigned __int64 time = 0;
 
     current = thread;
     current->reply_size = 0;
@@ -242,12 +244,18 @@ static void call_req_handler( struct thread *thread )
     memset( &reply, 0, sizeof(reply) );
 
     if (debug_level) trace_request();
+    if (request_stats) time = get_request_stats_time();
 
     if (req < REQ_NB_REQUESTS)
         req_handlers[req]( &current->req, &reply );
     else
         set_error( STATUS_NOT_IMPLEMENTED );
 
+    if (request_stats)
+        add_request_stats( req, get_request_stats_time() - time,
+                           sizeof(thread->req) + request_size,
+                           sizeof(reply) + (current ? current->reply_size : 0) );
+
     if (current)
     {
         if (current->reply_fd)
@@ -273,20 +281,41 @@ void read_request( struct thread *thread )
 
     if (!thread->req_toread)  /* no pending request */
     {
-        if ((ret = read( get_unix_fd( thread->request_fd ), &thread->req,
-                         sizeof(thread->req) )) != sizeof(thread->req)) goto error;
-        if (!(thread->req_toread = thread->req.request_header.request_size))
+        struct iovec vec[2];
+        data_size_t size;
+
+        /* small request data is read along with the header in a single call */
+        vec[0].iov_base = &thread->req;
+        vec[0].iov_len  = sizeof(thread->req);
+        vec[1].iov_base = thread->req_buffer;
+        vec[1].iov_len  = sizeof(thread->req_buffer);
+
+        if ((ret = readv( get_unix_fd( thread->request_fd ), vec, 2 )) < (int)sizeof(thread->req))
+            goto error;
+        size = ret - sizeof(thread->req);
+        if (size > thread->req.request_header.request_size)
+        {
+            fatal_protocol_error( thread, "extra data %u for request %d\n",
+                                  size - thread->req.request_header.request_size,
+                                  thread->req.request_header.req );
+            return;
+        }
+        if (!(thread->req_toread = thread->req.request_header.request_size - size))
         {
-            /* no data, handle request at once */
+            /* got everything, handle request at once */
+            if (size) thread->req_data = thread->req_buffer;
             call_req_handler( thread );
+            thread->req_data = NULL;
             return;
         }
-        if (!(thread->req_data = malloc( thread->req_toread )))
+        if (!(thread->req_data = malloc( thread->req.request_header.request_size )))
         {
             fatal_protocol_error( thread, "no memory for %u bytes request %d\n",
-                                  thread->req_toread, thread->req.request_header.req );
+                                  thread->req.request_header.request_size,
+                                  thread->req.request_header.req );
             return;
         }
+        memcpy( thread->req_data, thread->req_buffer, size );
     }
 
     /* read the variable sized data */
@@ -820,6 +849,7 @@ static void close_socket_timeout( void *arg )
 {
     master_timeout = NULL;
     flush_registry();
+    if (request_stats) dump_request_stats();
     if (debug_level) fprintf( stderr, "wineserver: exiting (pid=%ld)\n", (long) getpid() );
 
 #ifdef DEBUG_OBJECTS
@@ -60,6 +60,10 @@ extern int server_dir_fd, config_dir_fd;
 
 extern void trace_request(void);
 extern void trace_reply( enum request req, const union generic_reply *reply );
+extern unsigned __int64 get_request_stats_time(void);
+extern void add_request_stats( enum request req, unsigned __int64 time, data_size_t in, data_size_t out );
+extern void dump_request_stats(void);
+extern void toggle_request_stats(void);
 
 /* get the request vararg data */
 static inline const void *get_req_data(void)
@@ -131,6 +135,7 @@ DECL_HANDLER(dup_handle);
 DECL_HANDLER(open_process);
 DECL_HANDLER(open_thread);
 DECL_HANDLER(select);
+DECL_HANDLER(init_fast_sync);
 DECL_HANDLER(create_event);
 DECL_HANDLER(event_op);
 DECL_HANDLER(query_event);
@@ -186,6 +191,8 @@ DECL_HANDLER(read_change);
 DECL_HANDLER(create_mapping);
 DECL_HANDLER(open_mapping);
 DECL_HANDLER(get_mapping_info);
+DECL_HANDLER(get_mapping_reloc_cache);
+DECL_HANDLER(create_mapping_reloc_cache);
 DECL_HANDLER(get_mapping_committed_range);
 DECL_HANDLER(add_mapping_committed_range);
 DECL_HANDLER(create_snapshot);
@@ -350,6 +357,7 @@ DECL_HANDLER(create_completion);
 DECL_HANDLER(open_completion);
 DECL_HANDLER(add_completion);
 DECL_HANDLER(remove_completion);
+DECL_HANDLER(remove_completions);
 DECL_HANDLER(query_completion);
 DECL_HANDLER(set_completion_info);
 DECL_HANDLER(add_fd_completion);
@@ -392,6 +400,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_open_process,
     (req_handler)req_open_thread,
     (req_handler)req_select,
+    (req_handler)req_init_fast_sync,
     (req_handler)req_create_event,
     (req_handler)req_event_op,
     (req_handler)req_query_event,
@@ -447,6 +456,8 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_create_mapping,
     (req_handler)req_open_mapping,
     (req_handler)req_get_mapping_info,
+    (req_handler)req_get_mapping_reloc_cache,
+    (req_handler)req_create_mapping_reloc_cache,
     (req_handler)req_get_mapping_committed_range,
     (req_handler)req_add_mapping_committed_range,
     (req_handler)req_create_snapshot,
@@ -611,6 +622,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_open_completion,
     (req_handler)req_add_completion,
     (req_handler)req_remove_completion,
+    (req_handler)req_remove_completions,
     (req_handler)req_query_completion,
     (req_handler)req_set_completion_info,
     (req_handler)req_add_fd_completion,
@@ -830,12 +842,17 @@ C_ASSERT( FIELD_OFFSET(struct select_reply, timeout) == 8 );
 C_ASSERT( FIELD_OFFSET(struct select_reply, call) == 16 );
 C_ASSERT( FIELD_OFFSET(struct select_reply, apc_handle) == 56 );
 C_ASSERT( sizeof(struct select_reply) == 64 );
+C_ASSERT( FIELD_OFFSET(struct init_fast_sync_request, handle) == 12 );
+C_ASSERT( FIELD_OFFSET(struct init_fast_sync_request, count) == 16 );
+C_ASSERT( sizeof(struct init_fast_sync_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct create_event_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_event_request, attributes) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_event_request, manual_reset) == 20 );
 C_ASSERT( FIELD_OFFSET(struct create_event_request, initial_state) == 24 );
+C_ASSERT( FIELD_OFFSET(struct create_event_request, fast_slot) == 28 );
 C_ASSERT( sizeof(struct create_event_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct create_event_reply, handle) == 8 );
+C_ASSERT( FIELD_OFFSET(struct create_event_reply, fast) == 12 );
 C_ASSERT( sizeof(struct create_event_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct event_op_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct event_op_request, op) == 16 );
@@ -882,8 +899,10 @@ C_ASSERT( FIELD_OFFSET(struct create_semaphore_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_semaphore_request, attributes) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_semaphore_request, initial) == 20 );
 C_ASSERT( FIELD_OFFSET(struct create_semaphore_request, max) == 24 );
+C_ASSERT( FIELD_OFFSET(struct create_semaphore_request, fast_slot) == 28 );
 C_ASSERT( sizeof(struct create_semaphore_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct create_semaphore_reply, handle) == 8 );
+C_ASSERT( FIELD_OFFSET(struct create_semaphore_reply, fast) == 12 );
 C_ASSERT( sizeof(struct create_semaphore_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct release_semaphore_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct release_semaphore_request, count) == 16 );
@@ -1175,6 +1194,16 @@ C_ASSERT( FIELD_OFFSET(struct get_mapping_info_reply, base) == 24 );
 C_ASSERT( FIELD_OFFSET(struct get_mapping_info_reply, mapping) == 32 );
 C_ASSERT( FIELD_OFFSET(struct get_mapping_info_reply, shared_file) == 36 );
 C_ASSERT( sizeof(struct get_mapping_info_reply) == 40 );
+C_ASSERT( FIELD_OFFSET(struct get_mapping_reloc_cache_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_mapping_reloc_cache_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_mapping_reloc_cache_reply, base) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_mapping_reloc_cache_reply, cache) == 16 );
+C_ASSERT( sizeof(struct get_mapping_reloc_cache_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct create_mapping_reloc_cache_request, handle) == 12 );
+C_ASSERT( FIELD_OFFSET(struct create_mapping_reloc_cache_request, base) == 16 );
+C_ASSERT( FIELD_OFFSET(struct create_mapping_reloc_cache_request, offset) == 24 );
+C_ASSERT( FIELD_OFFSET(struct create_mapping_reloc_cache_request, end) == 28 );
+C_ASSERT( sizeof(struct create_mapping_reloc_cache_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct get_mapping_committed_range_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct get_mapping_committed_range_request, offset) == 16 );
 C_ASSERT( sizeof(struct get_mapping_committed_range_request) == 24 );
@@ -2150,6 +2179,9 @@ C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, cvalue) == 16 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, information) == 24 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, status) == 32 );
 C_ASSERT( sizeof(struct remove_completion_reply) == 40 );
+C_ASSERT( FIELD_OFFSET(struct remove_completions_request, handle) == 12 );
+C_ASSERT( sizeof(struct remove_completions_request) == 16 );
+C_ASSERT( sizeof(struct remove_completions_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_request, handle) == 12 );
 C_ASSERT( sizeof(struct query_completion_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_reply, depth) == 8 );
@@ -33,6 +33,7 @@
 
 #include "handle.h"
 #include "thread.h"
+#include "process.h"
 #include "request.h"
 #include "security.h"
 
@@ -41,21 +42,24 @@ struct semaphore
     struct object  obj;    /* object header */
     unsigned int   count;  /* current count */
     unsigned int   max;    /* maximum possible count */
+    struct fast_sync_slot *fast; /* client-side count, until the server takes it over */
 };
 
 static void semaphore_dump( struct object *obj, int verbose );
 static struct object_type *semaphore_get_type( struct object *obj );
+static int semaphore_add_queue( struct object *obj, struct wait_queue_entry *entry );
 static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int semaphore_map_access( struct object *obj, unsigned int access );
 static int semaphore_signal( struct object *obj, unsigned int access );
+static int semaphore_close_handle( struct object *obj, struct process *process, obj_handle_t handle );
 
 static const struct object_ops semaphore_ops =
 {
     sizeof(struct semaphore),      /* size */
     semaphore_dump,                /* dump */
     semaphore_get_type,            /* get_type */
-    add_queue,                     /* add_queue */
+    semaphore_add_queue,           /* add_queue */
     remove_queue,                  /* remove_queue */
     semaphore_signaled,            /* signaled */
     semaphore_satisfied,           /* satisfied */
@@ -66,7 +70,7 @@ static const struct object_ops semaphore_ops =
     default_set_sd,                /* set_sd */
     no_lookup_name,                /* lookup_name */
     no_open_file,                  /* open_file */
-    no_close_handle,               /* close_handle */
+    semaphore_close_handle,        /* close_handle */
     no_destroy                     /* destroy */
 };
 
@@ -89,6 +93,7 @@ static struct semaphore *create_semaphore( struct directory *root, const struct
             /* initialize it if it didn't already exist */
             sem->count = initial;
             sem->max   = max;
+            sem->fast  = NULL;
             if (sd) default_set_sd( &sem->obj, sd, OWNER_SECURITY_INFORMATION|
                                                    GROUP_SECURITY_INFORMATION|
                                                    DACL_SECURITY_INFORMATION|
@@ -98,6 +103,26 @@ static struct semaphore *create_semaphore( struct directory *root, const struct
     return sem;
 }
 
+/* take over the count of a semaphore that was managed by the client so far */
+static void semaphore_release_fast_sync( struct semaphore *sem )
+{
+    int count;
+
+    if (!sem->fast) return;
+    count = release_fast_sync_slot( sem->fast );
+    sem->count = count < 0 ? 0 : min( count, sem->max );
+    sem->fast = NULL;
+}
+
+static struct semaphore *get_semaphore_obj( struct process *process, obj_handle_t handle,
+                                            unsigned int access )
+{
+    struct semaphore *sem = (struct semaphore *)get_handle_obj( process, handle, access, &semaphore_ops );
+
+    if (sem) semaphore_release_fast_sync( sem );
+    return sem;
+}
+
 static int release_semaphore( struct semaphore *sem, unsigned int count,
                               unsigned int *prev )
 {
@@ -124,7 +149,7 @@ static void semaphore_dump( struct object *obj, int verbose )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    fprintf( stderr, "Semaphore count=%d max=%d ", sem->count, sem->max );
+    fprintf( stderr, "Semaphore count=%d max=%d fast=%p ", sem->count, sem->max, sem->fast );
     dump_object_name( &sem->obj );
     fputc( '\n', stderr );
 }
@@ -136,10 +161,19 @@ static struct object_type *semaphore_get_type( struct object *obj )
     return get_object_type( &str );
 }
 
+static int semaphore_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+    assert( obj->ops == &semaphore_ops );
+    semaphore_release_fast_sync( sem );
+    return add_queue( obj, entry );
+}
+
 static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
+    semaphore_release_fast_sync( sem );
     return (sem->count > 0);
 }
 
@@ -170,9 +204,19 @@ static int semaphore_signal( struct object *obj, unsigned int access )
         set_error( STATUS_ACCESS_DENIED );
         return 0;
     }
+    semaphore_release_fast_sync( sem );
     return release_semaphore( sem, 1, NULL );
 }
 
+static int semaphore_close_handle( struct object *obj, struct process *process, obj_handle_t handle )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+    assert( obj->ops == &semaphore_ops );
+    /* the client frees the slot once the handle is closed */
+    semaphore_release_fast_sync( sem );
+    return 1;
+}
+
 /* create a semaphore */
 DECL_HANDLER(create_semaphore)
 {
@@ -198,7 +242,12 @@ DECL_HANDLER(create_semaphore)
         if (get_error() == STATUS_OBJECT_NAME_EXISTS)
             reply->handle = alloc_handle( current->process, sem, req->access, req->attributes );
         else
+        {
             reply->handle = alloc_handle_no_access_check( current->process, sem, req->access, req->attributes );
+            /* the client keeps the count of unnamed semaphores until the server needs it */
+            if (reply->handle && !name.len)
+                reply->fast = (sem->fast = get_fast_sync_slot( current->process, req->fast_slot )) != NULL;
+        }
         release_object( sem );
     }
 
@@ -230,8 +279,7 @@ DECL_HANDLER(release_semaphore)
 {
     struct semaphore *sem;
 
-    if ((sem = (struct semaphore *)get_handle_obj( current->process, req->handle,
-                                                   SEMAPHORE_MODIFY_STATE, &semaphore_ops )))
+    if ((sem = get_semaphore_obj( current->process, req->handle, SEMAPHORE_MODIFY_STATE )))
     {
         release_semaphore( sem, req->count, &reply->prev_count );
         release_object( sem );
@@ -243,8 +291,7 @@ DECL_HANDLER(query_semaphore)
 {
     struct semaphore *sem;
 
-    if ((sem = (struct semaphore *)get_handle_obj( current->process, req->handle,
-                                                   SEMAPHORE_QUERY_STATE, &semaphore_ops )))
+    if ((sem = get_semaphore_obj( current->process, req->handle, SEMAPHORE_QUERY_STATE )))
     {
         reply->current = sem->count;
         reply->max = sem->max;
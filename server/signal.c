@@ -94,6 +94,7 @@ static const struct fd_ops handler_fd_ops =
 };
 
 static struct handler *handler_sighup;
+static struct handler *handler_sigusr1;
 static struct handler *handler_sigterm;
 static struct handler *handler_sigint;
 static struct handler *handler_sigchld;
@@ -180,10 +181,17 @@ static void sighup_callback(void)
 #endif
 }
 
+/* SIGUSR1 callback */
+static void sigusr1_callback(void)
+{
+    toggle_request_stats();
+}
+
 /* SIGTERM callback */
 static void sigterm_callback(void)
 {
     flush_registry();
+    if (request_stats) dump_request_stats();
     exit(1);
 }
 
@@ -199,6 +207,12 @@ static void do_sighup( int signum )
     do_signal( handler_sighup );
 }
 
+/* SIGUSR1 handler */
+static void do_sigusr1( int signum )
+{
+    do_signal( handler_sigusr1 );
+}
+
 /* SIGTERM handler */
 static void do_sigterm( int signum )
 {
@@ -273,6 +287,7 @@ void init_signals(void)
     sigset_t blocked_sigset;
 
     if (!(handler_sighup  = create_handler( sighup_callback ))) goto error;
+    if (!(handler_sigusr1 = create_handler( sigusr1_callback ))) goto error;
     if (!(handler_sigterm = create_handler( sigterm_callback ))) goto error;
     if (!(handler_sigint  = create_handler( sigint_callback ))) goto error;
     if (!(handler_sigchld = create_handler( sigchld_callback ))) goto error;
@@ -281,6 +296,7 @@ void init_signals(void)
     sigemptyset( &blocked_sigset );
     sigaddset( &blocked_sigset, SIGCHLD );
     sigaddset( &blocked_sigset, SIGHUP );
+    sigaddset( &blocked_sigset, SIGUSR1 );
     sigaddset( &blocked_sigset, SIGINT );
     sigaddset( &blocked_sigset, SIGALRM );
     sigaddset( &blocked_sigset, SIGIO );
@@ -299,6 +315,8 @@ void init_signals(void)
 #endif
     action.sa_handler = do_sighup;
     sigaction( SIGHUP, &action, NULL );
+    action.sa_handler = do_sigusr1;
+    sigaction( SIGUSR1, &action, NULL );
     action.sa_handler = do_sigint;
     sigaction( SIGINT, &action, NULL );
     action.sa_handler = do_sigalrm;
@@ -1054,7 +1054,9 @@ DECL_HANDLER(enable_socket_event)
     sock->state &= ~req->cstate;
     if ( sock->type != SOCK_STREAM ) sock->state &= ~STREAM_FLAG_MASK;
 
-    sock_reselect( sock );
+    /* the held events don't affect polling until some events are selected,
+       set_socket_event will reselect then */
+    if (sock->mask || req->sstate || req->cstate) sock_reselect( sock );
 
     release_object( &sock->obj );
 }
@@ -271,7 +271,7 @@ static void cleanup_thread( struct thread *thread )
 
     clear_apc_queue( &thread->system_apc );
     clear_apc_queue( &thread->user_apc );
-    free( thread->req_data );
+    if (thread->req_data != thread->req_buffer) free( thread->req_data );
     free( thread->reply_data );
     if (thread->request_fd) release_object( thread->request_fd );
     if (thread->reply_fd) release_object( thread->reply_fd );
@@ -864,6 +864,23 @@ static timeout_t select_on( const select_op_t *select_op, data_size_t op_size, c
     return timeout;
 }
 
+/* attempt to wake up a thread after the state of one of its wait objects has changed */
+static int wake_thread_object( struct wait_queue_entry *entry )
+{
+    struct thread_wait *wait = entry->wait;
+    struct thread *thread = wait->thread;
+
+    /* a wait-any can only have become satisfied through this object, so there is
+     * no need to rescan all the other objects unless something else is pending */
+    if (wait->select == SELECT_WAIT && thread->wait == wait &&
+        list_empty( &thread->system_apc ) && list_empty( &thread->user_apc ) &&
+        wait->timeout > current_time &&
+        !entry->obj->ops->signaled( entry->obj, entry ))
+        return 0;
+
+    return wake_thread( thread );
+}
+
 /* attempt to wake threads sleeping on the object wait queue */
 void wake_up( struct object *obj, int max )
 {
@@ -873,7 +890,7 @@ void wake_up( struct object *obj, int max )
     LIST_FOR_EACH( ptr, &obj->wait_queue )
     {
         struct wait_queue_entry *entry = LIST_ENTRY( ptr, struct wait_queue_entry, entry );
-        if (!(ret = wake_thread( get_wait_queue_thread( entry )))) continue;
+        if (!(ret = wake_thread_object( entry ))) continue;
         if (ret > 0 && max && !--max) break;
         /* restart at the head of the list since a wake up can change the object wait queue */
         ptr = &obj->wait_queue;
@@ -24,7 +24,13 @@
 #include <ctype.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
+#ifdef HAVE_SYS_TIME_H
+# include <sys/time.h>
+#endif
+#include <time.h>
 
 #ifdef HAVE_SYS_UIO_H
 #include <sys/uio.h>
@@ -814,6 +820,25 @@ static void dump_varargs_properties( const char *prefix, data_size_t size )
     remove_data( size );
 }
 
+static void dump_varargs_completion_msgs( const char *prefix, data_size_t size )
+{
+    const completion_msg_t *msg = cur_data;
+    data_size_t len = size / sizeof(*msg);
+
+    fprintf( stderr,"%s{", prefix );
+    while (len > 0)
+    {
+        dump_uint64( "{ckey=", &msg->ckey );
+        dump_uint64( ",cvalue=", &msg->cvalue );
+        dump_uint64( ",information=", &msg->information );
+        fprintf( stderr, ",status=%s}", get_status_name( msg->status ) );
+        msg++;
+        if (--len) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+    remove_data( size );
+}
+
 static void dump_varargs_LUID_AND_ATTRIBUTES( const char *prefix, data_size_t size )
 {
     const LUID_AND_ATTRIBUTES *lat = cur_data;
@@ -1404,18 +1429,26 @@ static void dump_select_reply( const struct select_reply *req )
     fprintf( stderr, ", apc_handle=%04x", req->apc_handle );
 }
 
+static void dump_init_fast_sync_request( const struct init_fast_sync_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", count=%08x", req->count );
+}
+
 static void dump_create_event_request( const struct create_event_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
     fprintf( stderr, ", attributes=%08x", req->attributes );
     fprintf( stderr, ", manual_reset=%d", req->manual_reset );
     fprintf( stderr, ", initial_state=%d", req->initial_state );
+    fprintf( stderr, ", fast_slot=%d", req->fast_slot );
     dump_varargs_object_attributes( ", objattr=", cur_size );
 }
 
 static void dump_create_event_reply( const struct create_event_reply *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", fast=%d", req->fast );
 }
 
 static void dump_event_op_request( const struct event_op_request *req )
@@ -1515,12 +1548,14 @@ static void dump_create_semaphore_request( const struct create_semaphore_request
     fprintf( stderr, ", attributes=%08x", req->attributes );
     fprintf( stderr, ", initial=%08x", req->initial );
     fprintf( stderr, ", max=%08x", req->max );
+    fprintf( stderr, ", fast_slot=%d", req->fast_slot );
     dump_varargs_object_attributes( ", objattr=", cur_size );
 }
 
 static void dump_create_semaphore_reply( const struct create_semaphore_reply *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", fast=%d", req->fast );
 }
 
 static void dump_release_semaphore_request( const struct release_semaphore_request *req )
@@ -2062,6 +2097,26 @@ static void dump_get_mapping_info_reply( const struct get_mapping_info_reply *re
     fprintf( stderr, ", shared_file=%04x", req->shared_file );
 }
 
+static void dump_get_mapping_reloc_cache_request( const struct get_mapping_reloc_cache_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_mapping_reloc_cache_reply( const struct get_mapping_reloc_cache_reply *req )
+{
+    dump_uint64( " base=", &req->base );
+    fprintf( stderr, ", cache=%04x", req->cache );
+}
+
+static void dump_create_mapping_reloc_cache_request( const struct create_mapping_reloc_cache_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    dump_uint64( ", base=", &req->base );
+    fprintf( stderr, ", offset=%08x", req->offset );
+    fprintf( stderr, ", end=%08x", req->end );
+    dump_varargs_bytes( ", data=", cur_size );
+}
+
 static void dump_get_mapping_committed_range_request( const struct get_mapping_committed_range_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -3985,6 +4040,16 @@ static void dump_remove_completion_reply( const struct remove_completion_reply *
     fprintf( stderr, ", status=%08x", req->status );
 }
 
+static void dump_remove_completions_request( const struct remove_completions_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_remove_completions_reply( const struct remove_completions_reply *req )
+{
+    dump_varargs_completion_msgs( " msgs=", cur_size );
+}
+
 static void dump_query_completion_request( const struct query_completion_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4112,6 +4177,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_process_request,
     (dump_func)dump_open_thread_request,
     (dump_func)dump_select_request,
+    (dump_func)dump_init_fast_sync_request,
     (dump_func)dump_create_event_request,
     (dump_func)dump_event_op_request,
     (dump_func)dump_query_event_request,
@@ -4167,6 +4233,8 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_create_mapping_request,
     (dump_func)dump_open_mapping_request,
     (dump_func)dump_get_mapping_info_request,
+    (dump_func)dump_get_mapping_reloc_cache_request,
+    (dump_func)dump_create_mapping_reloc_cache_request,
     (dump_func)dump_get_mapping_committed_range_request,
     (dump_func)dump_add_mapping_committed_range_request,
     (dump_func)dump_create_snapshot_request,
@@ -4331,6 +4399,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_request,
     (dump_func)dump_add_completion_request,
     (dump_func)dump_remove_completion_request,
+    (dump_func)dump_remove_completions_request,
     (dump_func)dump_query_completion_request,
     (dump_func)dump_set_completion_info_request,
     (dump_func)dump_add_fd_completion_request,
@@ -4370,6 +4439,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_process_reply,
     (dump_func)dump_open_thread_reply,
     (dump_func)dump_select_reply,
+    NULL,
     (dump_func)dump_create_event_reply,
     NULL,
     (dump_func)dump_query_event_reply,
@@ -4425,6 +4495,8 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_create_mapping_reply,
     (dump_func)dump_open_mapping_reply,
     (dump_func)dump_get_mapping_info_reply,
+    (dump_func)dump_get_mapping_reloc_cache_reply,
+    NULL,
     (dump_func)dump_get_mapping_committed_range_reply,
     NULL,
     (dump_func)dump_create_snapshot_reply,
@@ -4589,6 +4661,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_reply,
     NULL,
     (dump_func)dump_remove_completion_reply,
+    (dump_func)dump_remove_completions_reply,
     (dump_func)dump_query_completion_reply,
     NULL,
     NULL,
@@ -4628,6 +4701,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "open_process",
     "open_thread",
     "select",
+    "init_fast_sync",
     "create_event",
     "event_op",
     "query_event",
@@ -4683,6 +4757,8 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "create_mapping",
     "open_mapping",
     "get_mapping_info",
+    "get_mapping_reloc_cache",
+    "create_mapping_reloc_cache",
     "get_mapping_committed_range",
     "add_mapping_committed_range",
     "create_snapshot",
@@ -4847,6 +4923,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "open_completion",
     "add_completion",
     "remove_completion",
+    "remove_completions",
     "query_completion",
     "set_completion_info",
     "add_fd_completion",
@@ -4872,6 +4949,7 @@ static const struct
     { "ADDRESS_ALREADY_ASSOCIATED",  STATUS_ADDRESS_ALREADY_ASSOCIATED },
     { "ALERTED",                     STATUS_ALERTED },
     { "ALIAS_EXISTS",                STATUS_ALIAS_EXISTS },
+    { "ALREADY_COMMITTED",           STATUS_ALREADY_COMMITTED },
     { "BAD_DEVICE_TYPE",             STATUS_BAD_DEVICE_TYPE },
     { "BAD_IMPERSONATION_LEVEL",     STATUS_BAD_IMPERSONATION_LEVEL },
     { "BREAKPOINT",                  STATUS_BREAKPOINT },
@@ -5030,3 +5108,101 @@ void trace_reply( enum request req, const union generic_reply *reply )
     else fprintf( stderr, "%04x: %d() = %s\n",
                   current->id, req, get_status_name(current->error) );
 }
+
+/* request statistics */
+
+struct request_stats
+{
+    unsigned int     count;       /* number of requests */
+    unsigned __int64 total_time;  /* total time spent in the handler, in ns */
+    unsigned __int64 max_time;    /* longest time spent in the handler, in ns */
+    unsigned __int64 bytes_in;    /* total size of requests, including data */
+    unsigned __int64 bytes_out;   /* total size of replies, including data */
+};
+
+static struct request_stats request_stats_table[REQ_NB_REQUESTS];
+
+/* get a timestamp in ns for the request statistics */
+unsigned __int64 get_request_stats_time(void)
+{
+    struct timeval tv;
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec ts;
+
+    if (!clock_gettime( CLOCK_MONOTONIC, &ts ))
+        return ts.tv_sec * (unsigned __int64)1000000000 + ts.tv_nsec;
+#endif
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec * (unsigned __int64)1000000000 + tv.tv_usec * 1000;
+}
+
+/* account for a processed request */
+void add_request_stats( enum request req, unsigned __int64 time, data_size_t in, data_size_t out )
+{
+    struct request_stats *stats;
+
+    if (req >= REQ_NB_REQUESTS) return;
+    stats = &request_stats_table[req];
+    stats->count++;
+    stats->total_time += time;
+    if (time > stats->max_time) stats->max_time = time;
+    stats->bytes_in  += in;
+    stats->bytes_out += out;
+}
+
+static int compare_request_stats( const void *p1, const void *p2 )
+{
+    const struct request_stats *stats1 = &request_stats_table[*(const int *)p1];
+    const struct request_stats *stats2 = &request_stats_table[*(const int *)p2];
+
+    if (stats1->total_time != stats2->total_time) return stats1->total_time < stats2->total_time ? 1 : -1;
+    return *(const int *)p1 - *(const int *)p2;
+}
+
+/* print the request statistics, sorted by total time */
+void dump_request_stats(void)
+{
+    int i, order[REQ_NB_REQUESTS];
+    struct request_stats total;
+
+    memset( &total, 0, sizeof(total) );
+    for (i = 0; i < REQ_NB_REQUESTS; i++) order[i] = i;
+    qsort( order, REQ_NB_REQUESTS, sizeof(order[0]), compare_request_stats );
+
+    fprintf( stderr, "%-32s %10s %12s %10s %10s %14s %14s\n",
+             "request", "count", "total (us)", "avg (us)", "max (us)", "bytes in", "bytes out" );
+    for (i = 0; i < REQ_NB_REQUESTS; i++)
+    {
+        const struct request_stats *stats = &request_stats_table[order[i]];
+
+        if (!stats->count) continue;
+        fprintf( stderr, "%-32s %10u %12.0f %10.2f %10.2f %14.0f %14.0f\n", req_names[order[i]],
+                 stats->count, stats->total_time / 1000.0, stats->total_time / 1000.0 / stats->count,
+                 stats->max_time / 1000.0, (double)stats->bytes_in, (double)stats->bytes_out );
+        total.count      += stats->count;
+        total.total_time += stats->total_time;
+        total.bytes_in   += stats->bytes_in;
+        total.bytes_out  += stats->bytes_out;
+        if (stats->max_time > total.max_time) total.max_time = stats->max_time;
+    }
+    if (total.count)
+        fprintf( stderr, "%-32s %10u %12.0f %10.2f %10.2f %14.0f %14.0f\n", "total",
+                 total.count, total.total_time / 1000.0, total.total_time / 1000.0 / total.count,
+                 total.max_time / 1000.0, (double)total.bytes_in, (double)total.bytes_out );
+}
+
+/* start collecting request statistics, or stop and print them if already collecting */
+void toggle_request_stats(void)
+{
+    if (request_stats)
+    {
+        dump_request_stats();
+        request_stats = 0;
+    }
+    else
+    {
+        memset( request_stats_table, 0, sizeof(request_stats_table) );
+        request_stats = 1;
+        fprintf( stderr, "wineserver: collecting request statistics\n" );
+    }
+}